@@ -0,0 +1,110 @@
+// Runs DacEtherdream against the Etherdream emulator over a few different
+// kinds of network (latency, jitter and stalls) for a fixed time each, and
+// logs how it got on : how many points a second got played, how many times
+// the emulator ran out of points, how many commands it refused and how
+// many times it had to reconnect. There's no window, it returns 1 if the
+// emulator ran out of points (or didn't play at all) in any of them, so
+// you can run it from a script.
+
+#include "ofMain.h"
+#include "ofxLaserDacEtherdream.h"
+#include "ofxLaserEtherdreamEmulator.h"
+
+using namespace ofxLaser;
+
+struct NetworkSettings {
+	string name;
+	float latencyMillis;
+	float jitterMillis;
+	float stallChance;
+	float stallMillis;
+	// how much time DacEtherdream keeps in the buffer. It only tops it
+	// up once there's a fair bit of room, so it can drop to about half
+	// of this, and stalls longer than that will make it run out.
+	float targetLatencyMillis;
+};
+
+int main() {
+
+	// the DAC's buffer is 1799 points, so at 30k it's 60ms. Anything that
+	// holds the network up for longer than that is bound to underflow.
+	vector<NetworkSettings> networks = {
+		{"wired", 0.5, 0.2, 0, 0, 15},
+		{"wifi", 4, 4, 0, 0, 15},
+		{"busy wifi", 8, 8, 0.002, 15, 15},
+		{"stalls", 1, 0.5, 0.005, 20, 50},
+	};
+	int pps = 30000;
+	int framerate = 60;
+	int secondsPerNetwork = 5;
+
+	// a circle that goes round, so every frame's different
+	int numframepoints = pps/framerate;
+	PointBuffer frame;
+
+	bool failed = false;
+	int port = 17765;
+
+	for(NetworkSettings& network : networks) {
+
+		EtherdreamEmulator emulator;
+		// a different port each time, the old one might not be free yet
+		if(!emulator.setup(port++)) {
+			ofLogError("couldn't start the emulator on port " + ofToString(emulator.getPort()));
+			return 1;
+		}
+		emulator.setLatency(network.latencyMillis);
+		emulator.setJitter(network.jitterMillis);
+		emulator.setStalls(network.stallChance, network.stallMillis);
+
+		DacEtherdream dac;
+		dac.setPointsPerSecond(pps);
+		dac.setTargetLatency(network.targetLatencyMillis);
+		dac.setup("127.0.0.1", emulator.getPort());
+
+		// give it a second to connect and fill its buffer, it's only the
+		// steady state we're interested in
+		uint64_t starttime = ofGetElapsedTimeMillis();
+		uint64_t measuretime = starttime + 1000;
+		uint64_t endtime = measuretime + secondsPerNetwork*1000;
+		bool measuring = false;
+		int framenum = 0;
+
+		while(ofGetElapsedTimeMillis()<endtime) {
+			if(!measuring && (ofGetElapsedTimeMillis()>=measuretime)) {
+				emulator.resetStats();
+				measuring = true;
+			}
+			frame.clear();
+			for(int i = 0; i<numframepoints; i++) {
+				float angle = ofMap(i, 0, numframepoints, 0, TWO_PI) + framenum*0.05;
+				frame.addPoint(400+cos(angle)*300, 400+sin(angle)*300, 255, 255, 255);
+			}
+			dac.sendFrame(frame);
+			framenum++;
+			ofSleepMillis(1000/framerate);
+		}
+
+		EtherdreamEmulatorStats stats = emulator.getStats();
+		dac.close();
+		emulator.close();
+
+		float seconds = (float)(ofGetElapsedTimeMillis()-measuretime)/1000.0f;
+		// it connects before we start measuring, so any more than that is
+		// it dropping out
+		int reconnects = MAX(stats.connections-1, 0);
+
+		ofLogNotice(network.name + " (" + ofToString(network.latencyMillis) + "ms latency, " + ofToString(network.jitterMillis) + "ms jitter, " + ofToString(network.stallChance*100) + "% chance of " + ofToString(network.stallMillis) + "ms stalls, " + ofToString(network.targetLatencyMillis) + "ms target latency)");
+		ofLogNotice("    played " + ofToString(stats.pointsPlayed/seconds, 0) + " points a second (of " + ofToString(pps) + "), received " + ofToString(stats.pointsReceived/seconds, 0));
+		ofLogNotice("    underflows " + ofToString(stats.underflows) + ", NAKs " + ofToString(stats.naksSent) + ", reconnects " + ofToString(reconnects) + ", most points in the buffer " + ofToString(stats.maxBufferFullness));
+
+		if((stats.underflows>0) || (stats.pointsPlayed==0)) failed = true;
+	}
+
+	if(failed) {
+		ofLogError("The emulator ran out of points (or never played any)");
+		return 1;
+	}
+	ofLogNotice("No underflows");
+	return 0;
+}
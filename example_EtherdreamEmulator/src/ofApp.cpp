@@ -0,0 +1,107 @@
+#include "ofApp.h"
+
+
+
+//--------------------------------------------------------------
+void ofApp::setup(){
+	
+	laserWidth = 800;
+	laserHeight = 800;
+	laser.setup(laserWidth, laserHeight);
+	
+	laser.addProjector(dac);
+	
+	// start the emulator first so the DAC has something to connect to
+	if(!emulator.setup()) {
+		ofLogError("Couldn't start the Etherdream emulator, is something else using port 7765?");
+	}
+	emulator.setLatency(latency);
+	dac.setup("127.0.0.1", emulator.getPort());
+	
+	laser.initGui(true);
+	
+}
+
+//--------------------------------------------------------------
+void ofApp::update(){
+	
+	float deltaTime = ofClamp(ofGetLastFrameTime(), 0, 0.2);
+	elapsedTime+=deltaTime;
+	
+	// prepares laser manager to receive new points
+	laser.update();
+	
+}
+
+
+void ofApp::draw() {
+	
+	ofBackground(40);
+	
+	// some circles going round so there's something to send
+	for(int i = 0; i<6; i++) {
+		ofColor c;
+		c.setHsb(i*40, 255, 255);
+		float angle = elapsedTime + (i*TWO_PI/6);
+		ofPoint p(laserWidth/2 + cos(angle)*250, laserHeight/2 + sin(angle)*250);
+		laser.drawCircle(p, 40, c);
+	}
+	
+	// sends points to the DAC
+	laser.send();
+	
+	laser.drawUI();
+	
+	ofxLaser::EtherdreamEmulatorStats stats = emulator.getStats();
+	
+	int ypos = laserHeight+20;
+	int xpos = 400;
+	ofDrawBitmapString("EMULATOR", xpos, ypos+=30);
+	ofDrawBitmapString("Latency : "+ofToString(latency)+"ms  (UP / DOWN)", xpos, ypos+=20);
+	ofDrawBitmapString("Jitter : "+ofToString(jitter)+"ms  (LEFT / RIGHT)", xpos, ypos+=20);
+	ofDrawBitmapString("Stalls : "+string(stalls ? "on" : "off")+"  (S)", xpos, ypos+=20);
+	ofDrawBitmapString("U to force an underflow, R to reset the stats", xpos, ypos+=20);
+	
+	ypos+=10;
+	ofDrawBitmapString("Buffer : "+ofToString(stats.bufferFullness)+" (max "+ofToString(stats.maxBufferFullness)+")", xpos, ypos+=20);
+	ofDrawBitmapString("Point rate : "+ofToString(stats.pointRate), xpos, ypos+=20);
+	ofDrawBitmapString("Points received / played : "+ofToString(stats.pointsReceived)+" / "+ofToString(stats.pointsPlayed), xpos, ypos+=20);
+	ofDrawBitmapString("Commands : "+ofToString(stats.commandsReceived)+"  NAKs : "+ofToString(stats.naksSent), xpos, ypos+=20);
+	ofDrawBitmapString("Underflows : "+ofToString(stats.underflows)+"  Connections : "+ofToString(stats.connections), xpos, ypos+=20);
+	
+}
+
+
+//--------------------------------------------------------------
+void ofApp::keyPressed(int key){
+	if(key == OF_KEY_UP) {
+		latency+=2;
+	} else if(key == OF_KEY_DOWN) {
+		latency = MAX(0, latency-2);
+	} else if(key == OF_KEY_RIGHT) {
+		jitter+=1;
+	} else if(key == OF_KEY_LEFT) {
+		jitter = MAX(0, jitter-1);
+	} else if(key == 's') {
+		stalls = !stalls;
+		// one command in a thousand stops it reading for 30ms
+		emulator.setStalls(stalls ? 0.001 : 0, 30);
+	} else if(key == 'u') {
+		emulator.forceUnderflow();
+	} else if(key == 'r') {
+		emulator.resetStats();
+	}
+	emulator.setLatency(latency);
+	emulator.setJitter(jitter);
+	
+	if(key=='f') {
+		ofToggleFullscreen();
+	}
+}
+
+//--------------------------------------------------------------
+void ofApp::exit(){
+	laser.saveSettings();
+	dac.close();
+	emulator.close();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxLaserManager.h"
+#include "ofxLaserDacEtherdream.h"
+#include "ofxLaserEtherdreamEmulator.h"
+
+#include "ofxGui.h"
+
+// Runs a pretend Etherdream inside the app and connects to it, so you can
+// see how the DAC copes with a bad network without any hardware.
+
+class ofApp : public ofBaseApp{
+	
+public:
+	void setup();
+	void update();
+	void draw();
+	void exit();
+	
+	void keyPressed  (int key);
+	
+	ofxLaser::Manager laser;
+	ofxLaser::DacEtherdream dac;
+	ofxLaser::EtherdreamEmulator emulator;
+	
+	int laserWidth;
+	int laserHeight;
+	
+	float latency = 2;
+	float jitter = 0;
+	bool stalls = false;
+	
+	float elapsedTime = 0;
+};
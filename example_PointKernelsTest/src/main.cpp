@@ -0,0 +1,194 @@
+// Checks that the point processing that works on 4 points at a time (SSE2
+// on intel, NEON on ARM) gives exactly the same numbers as the old point by
+// point code in Projector::processPoints, on lots of random points. That's
+// the flip, rotate and clamp, and then the colour calibration. There's no
+// window, it just logs the results and returns 1 if anything was
+// different, so you can run it from a script.
+//
+// To check the plain float version instead, build it with OFXLASER_NO_SIMD
+// defined (eg add PROJECT_DEFINES = OFXLASER_NO_SIMD to config.make).
+
+// same as in ofxLaserPointKernels.cpp, otherwise the compiler could fuse
+// the old code's multiplies and adds and then it wouldn't match
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "ofMain.h"
+#include "ofxLaserPointKernels.h"
+#include "ofxLaserCalibrationTable.h"
+#include "SimdUtils.h"
+#include <random>
+
+using namespace ofxLaser;
+
+// the old Projector::calculateCalibratedBrightness
+float calculateCalibratedBrightnessOld(float value, float intensity, float level100, float level75, float level50, float level25, float level0){
+	value/=255.0f;
+	value *=intensity;
+	if(value<0.001) {
+		return 0;
+	} else if(value<0.25) {
+		return ofMap(value, 0, 0.25, level0, level25) *255;
+	} else if(value<0.5) {
+		return ofMap(value, 0.25, 0.5,level25, level50) *255;
+	} else if(value<0.75) {
+		return ofMap(value, 0.5, 0.75,level50, level75) *255;
+	} else {
+		return ofMap(value, 0.75, 1,level75, level100) *255;
+	}
+}
+
+// the old loop from Projector::processPoints, levels are 0, 25, 50, 75, 100%
+void processPointsOld(PointBuffer& points, bool flipX, bool flipY, bool rotate, float angle, float brightness, float* red, float* green, float* blue) {
+
+	for(int i = 0; i<points.size(); i++) {
+
+		float& x = points.x[i];
+		float& y = points.y[i];
+		float& r = points.r[i];
+		float& g = points.g[i];
+		float& b = points.b[i];
+
+		if(flipY) y = 800-y;
+		if(flipX) x = 800-x;
+		if(rotate) {
+			auto rotatedVec = glm::rotate(glm::vec3(x-400,y-400,0.0f), angle, glm::vec3(0.0f, 0.0f, 1.0f));
+			x=rotatedVec.x+400;
+			y=rotatedVec.y+400;
+		}
+
+		// bounds check
+		if(x<0) x = r = g = b = 0;
+		else if(x>800) {
+			x = 800;
+			r = g = b = 0;
+		}
+		if(y<0) y = r = g = b = 0;
+		else if(y>800) {
+			y = 800;
+			r = g = b = 0;
+		}
+
+		if(points.flags[i] & PointBuffer::FLAG_USE_CALIBRATION) {
+			r = calculateCalibratedBrightnessOld(r, brightness, red[4], red[3], red[2], red[1], red[0]);
+			g = calculateCalibratedBrightnessOld(g, brightness, green[4], green[3], green[2], green[1], green[0]);
+			b = calculateCalibratedBrightnessOld(b, brightness, blue[4], blue[3], blue[2], blue[1], blue[0]);
+		}
+	}
+}
+
+// what Projector::processPoints does now
+void processPointsNew(PointBuffer& points, bool flipX, bool flipY, bool rotate, float angle, float brightness, float* red, float* green, float* blue) {
+
+	CalibrationTable redCalibration, greenCalibration, blueCalibration;
+	redCalibration.update(vector<float>(red, red+5), brightness);
+	greenCalibration.update(vector<float>(green, green+5), brightness);
+	blueCalibration.update(vector<float>(blue, blue+5), brightness);
+
+	transformPoints(points, flipX, flipY, rotate, angle);
+	redCalibration.apply(points.r.data(), points.flags.data(), points.size());
+	greenCalibration.apply(points.g.data(), points.flags.data(), points.size());
+	blueCalibration.apply(points.b.data(), points.flags.data(), points.size());
+}
+
+bool isSame(float a, float b) {
+	// has to be the same bits, not just ==
+	return memcmp(&a, &b, sizeof(float))==0;
+}
+
+int main() {
+
+#if defined(OFXLASER_SIMD_SSE2)
+	string simdname = "SSE2";
+#elif defined(OFXLASER_SIMD_NEON)
+	string simdname = "NEON";
+#else
+	string simdname = "plain floats";
+#endif
+	ofLogNotice("Testing the point processing (" + simdname + ") against the old code");
+
+	// always the same random numbers so any failures can be repeated
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-200, 1000);
+	std::uniform_real_distribution<float> colour(0, 255);
+	std::uniform_real_distribution<float> level(0, 1);
+
+	int numframes = 5000;
+	int numpoints = 0;
+	int numdifferent = 0;
+
+	for(int frame = 0; frame<numframes; frame++) {
+
+		bool flipX = random()%2;
+		bool flipY = random()%2;
+		// a third of the frames aren't rotated, some of those have a
+		// rotation that's small enough to be ignored
+		float rotation = 0;
+		switch(random()%3) {
+			case 0 : rotation = (random()%2) ? 0 : 0.4f; break;
+			default : rotation = (float)((int)(random()%3600)-1800)/10.0f;
+		}
+		bool rotate = abs(rotation)>0.5;
+		float angle = ofDegToRad(rotation);
+
+		// intensity * master intensity, sometimes more than 1
+		float brightness = level(random)*1.2f;
+		float red[5], green[5], blue[5];
+		for(int i = 0; i<5; i++) {
+			red[i] = level(random);
+			green[i] = level(random);
+			blue[i] = level(random);
+		}
+
+		// any number of points so we get all the left over cases
+		PointBuffer points;
+		int count = random()%100;
+		for(int i = 0; i<count; i++) {
+			float x = position(random);
+			float y = position(random);
+			// some right on the edges
+			if(random()%10==0) x = (random()%2) ? 0 : 800;
+			if(random()%10==0) y = (random()%2) ? 0 : 800;
+			float r = colour(random);
+			float g = colour(random);
+			float b = colour(random);
+			// some right on the corners of the calibration curve, and
+			// some that are too bright
+			if((random()%10==0) && (brightness>0)) r = (float)(random()%5)*63.75f/brightness;
+			if(random()%20==0) g = 255+colour(random);
+			if(random()%20==0) b = 0.001f*255/MAX(brightness, 0.01f);
+			points.addPoint(x, y, r, g, b, random()%2);
+		}
+		PointBuffer expected = points;
+
+		processPointsNew(points, flipX, flipY, rotate, angle, brightness, red, green, blue);
+		processPointsOld(expected, flipX, flipY, rotate, angle, brightness, red, green, blue);
+
+		for(int i = 0; i<count; i++) {
+			numpoints++;
+			if(isSame(points.x[i], expected.x[i]) && isSame(points.y[i], expected.y[i]) &&
+			   isSame(points.r[i], expected.r[i]) && isSame(points.g[i], expected.g[i]) && isSame(points.b[i], expected.b[i])) continue;
+
+			if(numdifferent<10) {
+				ofLogError("frame " + ofToString(frame) + " point " + ofToString(i) + " is " +
+						   ofToString(points.x[i]) + ", " + ofToString(points.y[i]) + " " +
+						   ofToString(points.r[i]) + " " + ofToString(points.g[i]) + " " + ofToString(points.b[i]) + " but should be " +
+						   ofToString(expected.x[i]) + ", " + ofToString(expected.y[i]) + " " +
+						   ofToString(expected.r[i]) + " " + ofToString(expected.g[i]) + " " + ofToString(expected.b[i]));
+			}
+			numdifferent++;
+		}
+	}
+
+	if(numdifferent>0) {
+		ofLogError(ofToString(numdifferent) + " of " + ofToString(numpoints) + " points are different");
+		return 1;
+	}
+	ofLogNotice("All " + ofToString(numpoints) + " points are the same");
+	return 0;
+}
@@ -0,0 +1,93 @@
+// Checks that Warper, which applies the homography itself, gives exactly
+// the same positions as cv::perspectiveTransform. It warps (and unwarps) a
+// grid of points with a few different random warps. There's no window, it
+// just logs the results and returns 1 if anything was different, so you can
+// run it from a script.
+//
+// This relies on OpenCV not using fused multiply-adds in
+// perspectiveTransform either, which it doesn't unless it's been built to
+// (eg with -march=native).
+
+#include "ofMain.h"
+#include "ofxLaserWarper.h"
+#include <random>
+
+using namespace ofxLaser;
+
+bool isSame(float a, float b) {
+	// has to be the same bits, not just ==
+	return memcmp(&a, &b, sizeof(float))==0;
+}
+
+int main() {
+
+	// always the same random numbers so any failures can be repeated
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> offset(-150, 150);
+
+	// a grid over the 800 x 800 space plus a bit outside it
+	vector<cv::Point2f> grid;
+	for(float y = -40; y<=840; y+=10) {
+		for(float x = -40; x<=840; x+=10) {
+			grid.push_back(cv::Point2f(x, y));
+		}
+	}
+	// and some that aren't on whole numbers
+	std::uniform_real_distribution<float> position(0, 800);
+	for(int i = 0; i<2000; i++) grid.push_back(cv::Point2f(position(random), position(random)));
+
+	int numwarps = 50;
+	int numpoints = 0;
+	int numdifferent = 0;
+
+	for(int i = 0; i<numwarps; i++) {
+
+		Warper warper;
+		glm::vec3 src[4] = {glm::vec3(0,0,0), glm::vec3(800,0,0), glm::vec3(0,800,0), glm::vec3(800,800,0)};
+		glm::vec3 dst[4];
+		for(int j = 0; j<4; j++) dst[j] = src[j] + glm::vec3(offset(random), offset(random), 0);
+		warper.updateHomography(src[0], src[1], src[2], src[3], dst[0], dst[1], dst[2], dst[3]);
+
+		vector<cv::Point2f> expected, expectedunwarped;
+		cv::perspectiveTransform(grid, expected, warper.homography);
+		cv::perspectiveTransform(grid, expectedunwarped, warper.inverseHomography);
+
+		// all the different ways of warping a point
+		vector<float> xs(grid.size()), ys(grid.size());
+		vector<Point> points(grid.size());
+		for(int j = 0; j<grid.size(); j++) {
+			xs[j] = grid[j].x;
+			ys[j] = grid[j].y;
+			points[j] = Point(ofPoint(grid[j].x, grid[j].y), ofColor::white);
+		}
+		warper.warpPoints(xs.data(), ys.data(), xs.size());
+		warper.warpPoints(points.data(), points.data(), points.size());
+
+		for(int j = 0; j<grid.size(); j++) {
+			numpoints++;
+			cv::Point2f warped = warper.getWarpedPoint(grid[j].x, grid[j].y);
+			glm::vec3 unwarped = warper.getUnWarpedPoint(glm::vec3(grid[j].x, grid[j].y, 0));
+			const cv::Point2f& e = expected[j];
+			const cv::Point2f& u = expectedunwarped[j];
+
+			if(isSame(warped.x, e.x) && isSame(warped.y, e.y) &&
+			   isSame(xs[j], e.x) && isSame(ys[j], e.y) &&
+			   isSame(points[j].x, e.x) && isSame(points[j].y, e.y) &&
+			   isSame(unwarped.x, u.x) && isSame(unwarped.y, u.y)) continue;
+
+			if(numdifferent<10) {
+				ofLogError("warp " + ofToString(i) + " point " + ofToString(grid[j].x) + ", " + ofToString(grid[j].y) + " is " +
+						   ofToString(warped.x) + ", " + ofToString(warped.y) + " (unwarped " + ofToString(unwarped.x) + ", " + ofToString(unwarped.y) + ") but should be " +
+						   ofToString(e.x) + ", " + ofToString(e.y) + " (unwarped " + ofToString(u.x) + ", " + ofToString(u.y) + ")");
+			}
+			numdifferent++;
+		}
+	}
+
+	if(numdifferent>0) {
+		ofLogError(ofToString(numdifferent) + " of " + ofToString(numpoints) + " points are different");
+		return 1;
+	}
+	ofLogNotice("All " + ofToString(numpoints) + " points are the same");
+	return 0;
+}
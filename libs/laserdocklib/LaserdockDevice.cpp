@@ -113,7 +113,7 @@ namespace {
             return false;
 
         rv = libusb_bulk_transfer(handle, (1 | LIBUSB_ENDPOINT_IN), response, 64, &transferred, 0);
-        if(rv != 0 || transferred != 64 || packet[1] != 0)
+        if(rv != 0 || transferred != 64 || response[1] != 0)
         {
             return false;
         }
@@ -287,6 +287,10 @@ bool LaserdockDevice::send_samples(LaserdockSample *samples, uint32_t count) {
     return this->send((unsigned char *) samples, sizeof(LaserdockSample)*count);
 }
 
+libusb_device_handle * LaserdockDevice::data_handle() const {
+    return d->devh_data;
+}
+
 bool LaserdockDevice::clear_ringbuffer() {
     return suint8(d->devh_ctl, 0x8D, 0);
 }
@@ -308,7 +312,7 @@ void LaserdockDevice::setFlipY(bool flip) {
 }
 
 bool LaserdockDevice::runner_mode_enable(bool v) {
-    uint8_t request[] = {0xC0, 0x01, v? (uint8_t)0x01: (uint8_t)0x00};
+    uint8_t request[4] = {0xC0, 0x01, v? (uint8_t)0x01: (uint8_t)0x00};
     uint32_t rlen = 4;
     uint8_t response[64];
     bool r =  sendraw(d->devh_ctl, request, rlen, response);
@@ -316,7 +320,7 @@ bool LaserdockDevice::runner_mode_enable(bool v) {
 }
 
 bool LaserdockDevice::runner_mode_run(bool v) {
-    uint8_t request[] = {0xC0, 0x09, v? (uint8_t)0x01: (uint8_t)0x00};
+    uint8_t request[4] = {0xC0, 0x09, v? (uint8_t)0x01: (uint8_t)0x00};
     uint32_t rlen = 4;
     uint8_t response[64];
     bool r =  sendraw(d->devh_ctl, request, rlen, response);
@@ -339,6 +343,7 @@ bool LaserdockDevice::runner_mode_load(LaserdockSample *samples, uint16_t positi
     uint32_t rlen = 64;
     uint8_t response[64];
     bool r =  sendraw(d->devh_ctl, request, rlen, response);
+    free(request);
 
     return r;
 }
@@ -31,6 +31,7 @@ typedef _jobject* jobject;
 #endif
 
 class libusb_device;
+struct libusb_device_handle;
 class LaserdockDevicePrivate;
 
 class LASERDOCKLIB_EXPORT LaserdockDevice {
@@ -76,6 +77,10 @@ public:
     bool send(unsigned char * data, uint32_t length);
     bool send_samples(LaserdockSample * samples, uint32_t count);
 
+    // the handle that the samples go to (endpoint 3), for sending them
+    // with asynchronous libusb transfers instead of send_samples
+    libusb_device_handle * data_handle() const;
+
     bool flixpX();
     bool flixpY();
 
@@ -0,0 +1,92 @@
+//
+//  ofxLaserCalibrationTable.cpp
+//  ofxLaser
+//
+//
+//
+
+// no fused multiply-adds, the results have to match ofMap exactly
+// (see ofxLaserPointKernels.cpp)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "ofxLaserCalibrationTable.h"
+#include "ofxLaserPointKernels.h"
+
+using namespace ofxLaser;
+
+bool CalibrationTable :: update(const vector<float>& newlevels, float newintensity) {
+
+	if((newlevels==levels) && (newintensity==intensity)) return false;
+
+	if(newlevels.size()<2) {
+		ofLogError("CalibrationTable :: update - need at least 2 levels");
+		return false;
+	}
+
+	levels = newlevels;
+	intensity = newintensity;
+
+	int numsegments = levels.size()-1;
+	segments.resize(numsegments);
+	for(int i = 0; i<numsegments; i++) {
+		Segment& segment = segments[i];
+		float end = (float)(i+1)/numsegments;
+		segment.start = (float)i/numsegments;
+		segment.size = end - segment.start;
+		segment.from = levels[i];
+		segment.change = levels[i+1] - levels[i];
+	}
+
+	return true;
+}
+
+void CalibrationTable :: apply(float* values, const uint8_t* flags, int count) const {
+
+	// 4 at a time, and no branches
+	calibrateColours(values, flags, count, *this);
+}
+
+float CalibrationTable :: getCalibratedValue(float value) const {
+
+	value/=255.0f;
+	value*=intensity;
+	if(value<getThreshold()) return 0;
+
+	// the last line that starts before the value, anything off the end
+	// carries on along the last line
+	int index = 0;
+	while((index+1<segments.size()) && (value>=segments[index+1].start)) index++;
+	const Segment& segment = segments[index];
+
+	// same as ofMap(value, start, end, from, to) * 255
+	return ((value - segment.start) / segment.size * segment.change + segment.from) * 255;
+}
+
+float CalibrationTable :: calculateLevel(float value, float intensity, const float* levels, int numlevels) {
+
+	value/=255.0f;
+	value*=intensity;
+	if(value<getThreshold()) return 0;
+
+	int numsegments = numlevels-1;
+	int index = 0;
+	while((index+1<numsegments) && (value>=(float)(index+1)/numsegments)) index++;
+	float start = (float)index/numsegments;
+	float end = (float)(index+1)/numsegments;
+
+	return ofMap(value, start, end, levels[index], levels[index+1]) * 255;
+}
+
+float CalibrationTable :: getThreshold() {
+
+	// 0.001 isn't exactly a float, so this is the smallest float that
+	// isn't less than it
+	static const float threshold = ((double)0.001f<0.001) ? nextafterf(0.001f, 1) : 0.001f;
+	return threshold;
+}
@@ -0,0 +1,67 @@
+//
+//  ofxLaserCalibrationTable.h
+//  ofxLaser
+//
+//
+//
+
+#pragma once
+#include "ofxLaserPointBuffer.h"
+
+namespace ofxLaser {
+
+	// The colour calibration for one colour channel, with the intensity
+	// already applied. The calibration curve is a straight line between
+	// each pair of levels, and the table has everything we need for each
+	// line. It's only rebuilt when the levels or intensity change, so for
+	// each point it's just a case of picking the right line (4 points at a
+	// time, see calibrateColours in ofxLaserPointKernels.h). The results
+	// are exactly the same as working out the curve with ofMap every time
+	// (the way Projector::calculateCalibratedBrightness does).
+	//
+	// The levels are the calibrated brightness (0-1) at evenly spaced input
+	// brightnesses, so the usual 5 levels are for 0, 25, 50, 75 and 100%.
+	// You can use as many levels as you like (minimum 2) for a more
+	// accurate curve.
+	class CalibrationTable {
+
+		public :
+
+		// rebuilds the table if anything has changed, returns true if it did
+		bool update(const vector<float>& newlevels, float newintensity);
+
+		// converts the values (0-255) for all the points that have
+		// FLAG_USE_CALIBRATION set. Values over 255 carry on along the
+		// last line.
+		void apply(float* values, const uint8_t* flags, int count) const;
+
+		float getCalibratedValue(float value) const;
+
+		// works out a calibrated value straight from the levels, without
+		// making a table
+		static float calculateLevel(float value, float intensity, const float* levels, int numlevels);
+
+		// anything darker than this (0-1, after the intensity) is turned
+		// off completely. It's the float version of value<0.001.
+		static float getThreshold();
+
+		// one of the lines in the curve, these are the same numbers that
+		// ofMap works out, in the same way
+		struct Segment {
+			float start; // the input brightness (0-1) where it starts
+			float size; // how far the line goes (end - start)
+			float from; // the level at the start
+			float change; // the level at the end - from
+		};
+		const vector<Segment>& getSegments() const { return segments; };
+		float getIntensity() const { return intensity; };
+
+		protected :
+
+		vector<float> levels;
+		float intensity = -1;
+
+		vector<Segment> segments;
+
+	};
+}
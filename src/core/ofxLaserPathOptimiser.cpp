@@ -0,0 +1,388 @@
+//
+//  ofxLaserPathOptimiser.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserPathOptimiser.h"
+
+using namespace ofxLaser;
+
+void PathOptimiser :: sort(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints) {
+
+	blankPointsSaved = 0;
+	blankPoints = 0;
+	sortedFromCache = false;
+	if(shapepoints.size()==0) {
+		previousOrder.clear();
+		return;
+	}
+
+	uint64_t endTime = ofGetElapsedTimeMicros() + budgetMicros;
+
+	if(useCache) sortedFromCache = sortFromCache(shapepoints, sortedshapepoints);
+	if(sortedFromCache) {
+		// moving content can leave the cached order much worse than
+		// starting again, so every so often we see what the nearest
+		// neighbour sort makes of it and keep whichever is better
+		framesSinceGreedyCheck++;
+		if(framesSinceGreedyCheck>=greedyCheckInterval) {
+			framesSinceGreedyCheck = 0;
+			int cachedBlankPoints = calculateBlankPoints(sortedshapepoints);
+			// the greedy sort changes which way round the segments are
+			cachedReversed.resize(sortedshapepoints.size());
+			for(int i = 0; i<sortedshapepoints.size(); i++) {
+				cachedReversed[i] = sortedshapepoints[i]->reversed;
+			}
+			greedyOrder.clear();
+			sortGreedy(shapepoints, greedyOrder);
+			if(calculateBlankPoints(greedyOrder)<cachedBlankPoints) {
+				sortedshapepoints.swap(greedyOrder);
+				sortedFromCache = false;
+			} else {
+				for(int i = 0; i<sortedshapepoints.size(); i++) {
+					sortedshapepoints[i]->reversed = cachedReversed[i];
+				}
+			}
+		}
+	} else {
+		sortGreedy(shapepoints, sortedshapepoints);
+		framesSinceGreedyCheck = 0;
+	}
+
+	blankPoints = calculateBlankPoints(sortedshapepoints);
+
+	if((mode!=OFXLASER_PATH_ORDER_GREEDY) && (sortedshapepoints.size()>=2)) {
+
+		int startBlankPoints = blankPoints;
+
+		// keep going until neither stage can find anything better, or we
+		// run out of time. 2-opt is cheaper to check so it goes first.
+		bool improved = true;
+		while(improved && (ofGetElapsedTimeMicros()<endTime)) {
+			improved = twoOpt(sortedshapepoints, endTime);
+			if(mode==OFXLASER_PATH_ORDER_OROPT) {
+				improved = orOpt(sortedshapepoints, endTime) || improved;
+			}
+		}
+
+		blankPoints = calculateBlankPoints(sortedshapepoints);
+		blankPointsSaved = startBlankPoints - blankPoints;
+	}
+
+	if(useCache) storeCache(sortedshapepoints);
+	else previousOrder.clear();
+}
+
+void PathOptimiser :: sortGreedy(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints) {
+
+	bool reversed = false;
+	int currentIndex = 0;
+
+	// the index stores the start and end of every segment in a grid
+	// so we only have to check the segments that are nearby
+	shapePointsIndex.build(shapepoints);
+
+	do {
+		ShapePoints& shapePoints1 = shapepoints[currentIndex];
+
+		shapePoints1.tested = true;
+		sortedshapepoints.push_back(&shapePoints1);
+		shapePoints1.reversed = reversed;
+		shapePointsIndex.remove(currentIndex);
+
+		currentIndex = shapePointsIndex.findNearest(shapePoints1.getEnd(), reversed);
+	}
+	while (currentIndex>-1);
+}
+
+int PathOptimiser :: getMovePoints(const ofPoint& from, const ofPoint& to, bool tohome) {
+
+	// matches what the projector adds in addPointsForMoveTo, we don't
+	// move at all if the points are close enough. There aren't any pre
+	// and post blanks on the way back home.
+	float distance = from.distance(to);
+	if(distance<=2) return 0;
+	return (int)ceil(distance/moveSpeed) + (tohome ? 0 : shapeBlankPoints);
+}
+
+int PathOptimiser :: calculateBlankPoints(vector<ShapePoints*>& path) {
+
+	if(path.size()==0) return 0;
+	int total = getMovePoints(startPosition, path.front()->getStart());
+	for(int i = 1; i<path.size(); i++) {
+		total+=getMovePoints(path[i-1]->getEnd(), path[i]->getStart());
+	}
+	if(returnToStart) total+=getMovePoints(path.back()->getEnd(), startPosition, true);
+	return total;
+}
+
+// reverses the order of the segments between first and last (inclusive)
+// and flips the direction of each one
+void PathOptimiser :: reverseSection(vector<ShapePoints*>& path, int first, int last) {
+
+	std::reverse(path.begin()+first, path.begin()+last+1);
+	for(int i = first; i<=last; i++) {
+		path[i]->reversed = !path[i]->reversed;
+	}
+}
+
+bool PathOptimiser :: twoOpt(vector<ShapePoints*>& path, uint64_t endTime) {
+
+	int n = (int)path.size();
+
+	// running count of non-reversable segments so that we can check if a
+	// section can be reversed. Non-reversable segments never get moved by
+	// 2-opt so this doesn't change while we're working.
+	nonReversableCount.resize(n+1);
+	nonReversableCount[0] = 0;
+	for(int i = 0; i<n; i++) {
+		nonReversableCount[i+1] = nonReversableCount[i] + (path[i]->reversable ? 0 : 1);
+	}
+
+	bool improved = false;
+
+	for(int i = 0; i<n; i++) {
+
+		if(ofGetElapsedTimeMicros()>endTime) break;
+
+		for(int j = i; j<n; j++) {
+
+			// once we hit a segment that can't be reversed, no longer
+			// section starting at i can be reversed either
+			if(nonReversableCount[j+1]-nonReversableCount[i]>0) break;
+
+			const ofPoint& before = (i==0) ? startPosition : path[i-1]->getEnd();
+			bool hasAfter = (j<n-1) || returnToStart;
+			const ofPoint& after = (j<n-1) ? path[j+1]->getStart() : startPosition;
+			bool afterhome = (j>=n-1);
+
+			int currentCost = getMovePoints(before, path[i]->getStart());
+			int newCost = getMovePoints(before, path[j]->getEnd());
+			if(hasAfter) {
+				currentCost+=getMovePoints(path[j]->getEnd(), after, afterhome);
+				newCost+=getMovePoints(path[i]->getStart(), after, afterhome);
+			}
+
+			if(newCost<currentCost) {
+				reverseSection(path, i, j);
+				improved = true;
+			}
+		}
+	}
+	return improved;
+}
+
+bool PathOptimiser :: orOpt(vector<ShapePoints*>& path, uint64_t endTime) {
+
+	int n = (int)path.size();
+	bool improved = false;
+
+	// try moving chains of 1 to 3 segments to anywhere else in the path,
+	// either way round if they can be reversed
+	for(int chainLength = 1; chainLength<=3; chainLength++) {
+		for(int i = 0; i+chainLength<=n; i++) {
+
+			if(ofGetElapsedTimeMicros()>endTime) return improved;
+
+			int last = i+chainLength-1;
+			bool canReverse = true;
+			for(int k = i; k<=last; k++) {
+				if(!path[k]->reversable) canReverse = false;
+			}
+
+			const ofPoint& chainStart = path[i]->getStart();
+			const ofPoint& chainEnd = path[last]->getEnd();
+			const ofPoint& prev = (i==0) ? startPosition : path[i-1]->getEnd();
+			bool hasNext = (last<n-1) || returnToStart;
+			const ofPoint& next = (last<n-1) ? path[last+1]->getStart() : startPosition;
+			bool nexthome = (last>=n-1);
+
+			// how much we save by taking the chain out
+			int removeGain = getMovePoints(prev, chainStart);
+			if(hasNext) {
+				removeGain+=getMovePoints(chainEnd, next, nexthome) - getMovePoints(prev, next, nexthome);
+			}
+			if(removeGain<=0) continue;
+
+			int bestCost = removeGain;
+			int bestPosition = -1;
+			bool bestReversed = false;
+
+			// k is the position to insert before, in the current path
+			for(int k = 0; k<=n; k++) {
+				if((k>=i) && (k<=last+1)) continue;
+
+				const ofPoint& a = (k==0) ? startPosition : path[k-1]->getEnd();
+				bool hasB = (k<n) || returnToStart;
+				const ofPoint& b = (k<n) ? path[k]->getStart() : startPosition;
+				bool bhome = (k>=n);
+
+				int existing = hasB ? getMovePoints(a, b, bhome) : 0;
+
+				int cost = getMovePoints(a, chainStart) - existing;
+				if(hasB) cost+=getMovePoints(chainEnd, b, bhome);
+				if(cost<bestCost) {
+					bestCost = cost;
+					bestPosition = k;
+					bestReversed = false;
+				}
+				if(canReverse) {
+					cost = getMovePoints(a, chainEnd) - existing;
+					if(hasB) cost+=getMovePoints(chainStart, b, bhome);
+					if(cost<bestCost) {
+						bestCost = cost;
+						bestPosition = k;
+						bestReversed = true;
+					}
+				}
+			}
+
+			if(bestPosition<0) continue;
+
+			chain.assign(path.begin()+i, path.begin()+last+1);
+			if(bestReversed) {
+				std::reverse(chain.begin(), chain.end());
+				for(ShapePoints* segment : chain) segment->reversed = !segment->reversed;
+			}
+			path.erase(path.begin()+i, path.begin()+last+1);
+			if(bestPosition>i) bestPosition-=chainLength;
+			path.insert(path.begin()+bestPosition, chain.begin(), chain.end());
+			improved = true;
+		}
+	}
+	return improved;
+}
+
+bool PathOptimiser :: sortFromCache(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints) {
+
+	if(previousOrder.size()==0) return false;
+
+	geometryLookup.clear();
+	identityLookup.clear();
+	matched.assign(shapepoints.size(), false);
+
+	int numSegments = 0;
+	for(int i = 0; i<shapepoints.size(); i++) {
+		ShapePoints& segment = shapepoints[i];
+		// empty segments don't add any points so we can just leave them out
+		if(segment.size()==0) {
+			matched[i] = true;
+			continue;
+		}
+		geometryLookup.emplace(getGeometryKey(segment), i);
+		identityLookup[segment.identity] = i;
+		numSegments++;
+	}
+
+	// match on geometry first, if the segment hasn't moved we definitely
+	// want it in the same place
+	int numMatched = 0;
+	previousMatches.assign(previousOrder.size(), -1);
+	for(int i = 0; i<previousOrder.size(); i++) {
+		auto range = geometryLookup.equal_range(previousOrder[i].geometryKey);
+		for(auto it = range.first; it!=range.second; ++it) {
+			if(!matched[it->second]) {
+				matched[it->second] = true;
+				previousMatches[i] = it->second;
+				numMatched++;
+				break;
+			}
+		}
+	}
+	// then anything left that came from the same zone / shape / segment,
+	// which catches shapes that are moving
+	for(int i = 0; i<previousOrder.size(); i++) {
+		if(previousMatches[i]>=0) continue;
+		auto it = identityLookup.find(previousOrder[i].identity);
+		if((it!=identityLookup.end()) && !matched[it->second]) {
+			matched[it->second] = true;
+			previousMatches[i] = it->second;
+			numMatched++;
+		}
+	}
+
+	// if most of the frame has changed then it's better to start again
+	if(numMatched*2<numSegments) return false;
+
+	for(int i = 0; i<previousOrder.size(); i++) {
+		if(previousMatches[i]<0) continue;
+		ShapePoints& segment = shapepoints[previousMatches[i]];
+		segment.reversed = previousOrder[i].reversed && segment.reversable;
+		segment.tested = true;
+		sortedshapepoints.push_back(&segment);
+	}
+
+	// add the new segments in wherever they add the fewest blank points
+	for(int i = 0; i<shapepoints.size(); i++) {
+		if(matched[i]) continue;
+		shapepoints[i].tested = true;
+		insertSegment(sortedshapepoints, &shapepoints[i]);
+	}
+
+	return true;
+}
+
+void PathOptimiser :: insertSegment(vector<ShapePoints*>& path, ShapePoints* segment) {
+
+	int n = (int)path.size();
+	const ofPoint& start = segment->front();
+	const ofPoint& end = segment->back();
+
+	int bestCost = INT_MAX;
+	int bestPosition = n;
+	bool bestReversed = false;
+
+	for(int k = 0; k<=n; k++) {
+		const ofPoint& a = (k==0) ? startPosition : path[k-1]->getEnd();
+		bool hasB = (k<n) || returnToStart;
+		const ofPoint& b = (k<n) ? path[k]->getStart() : startPosition;
+		bool bhome = (k>=n);
+
+		int existing = hasB ? getMovePoints(a, b, bhome) : 0;
+
+		int cost = getMovePoints(a, start) - existing;
+		if(hasB) cost+=getMovePoints(end, b, bhome);
+		if(cost<bestCost) {
+			bestCost = cost;
+			bestPosition = k;
+			bestReversed = false;
+		}
+		if(segment->reversable) {
+			cost = getMovePoints(a, end) - existing;
+			if(hasB) cost+=getMovePoints(start, b, bhome);
+			if(cost<bestCost) {
+				bestCost = cost;
+				bestPosition = k;
+				bestReversed = true;
+			}
+		}
+	}
+	segment->reversed = bestReversed;
+	path.insert(path.begin()+bestPosition, segment);
+}
+
+void PathOptimiser :: storeCache(vector<ShapePoints*>& path) {
+
+	previousOrder.resize(path.size());
+	for(int i = 0; i<path.size(); i++) {
+		CacheEntry& entry = previousOrder[i];
+		entry.geometryKey = getGeometryKey(*path[i]);
+		entry.identity = path[i]->identity;
+		entry.reversed = path[i]->reversed;
+	}
+}
+
+uint64_t PathOptimiser :: getGeometryKey(ShapePoints& segment) {
+
+	// always uses the un-reversed ends so the key doesn't change
+	// if the segment gets flipped
+	uint64_t key = segment.size();
+	float values[4] = {segment.front().x, segment.front().y, segment.back().x, segment.back().y};
+	for(float value : values) {
+		uint64_t rounded = (uint64_t)(int64_t)floor(value/cacheTolerance);
+		key ^= rounded + 0x9e3779b97f4a7c15ULL + (key<<6) + (key>>2);
+	}
+	return key;
+}
@@ -0,0 +1,100 @@
+//
+//  ofxLaserPathOptimiser.h
+//  ofxLaser
+//
+//
+//
+
+#pragma once
+#include "ofxLaserShapePoints.h"
+#include "ofxLaserShapePointsIndex.h"
+#include <unordered_map>
+
+enum ofxLaserPathOrderMode {
+	OFXLASER_PATH_ORDER_GREEDY, // nearest neighbour only
+	OFXLASER_PATH_ORDER_2OPT, // nearest neighbour then 2-opt
+	OFXLASER_PATH_ORDER_OROPT // nearest neighbour, 2-opt then or-opt
+};
+
+namespace ofxLaser {
+
+	// Sorts all the segments for a frame to minimise the number of blank points
+	// we need to move between them. We always start with the nearest neighbour
+	// sort, and the refinement stages try to improve on that until the time
+	// budget runs out.
+	// If useCache is on, we start from the order of the last frame instead,
+	// matching segments by their geometry or by which shape they came from,
+	// and just insert any new segments wherever they fit best. This is much
+	// quicker and stops the scan path from jumping around between frames.
+	// Every greedyCheckInterval frames we also do the nearest neighbour sort
+	// and use that instead if it's better.
+	class PathOptimiser {
+
+		public :
+
+		void sort(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints);
+
+		// the number of blank points that addPointsForMoveTo (plus the pre and post
+		// blanks, which aren't added on the move back home) would add for the
+		// whole path
+		int calculateBlankPoints(vector<ShapePoints*>& path);
+		int getMovePoints(const ofPoint& from, const ofPoint& to, bool tohome = false);
+
+		int getBlankPoints() { return blankPoints; };
+		// how many blank points the refinement saved compared with the
+		// starting order (either the greedy sort or the cached order)
+		int getBlankPointsSaved() { return blankPointsSaved; };
+		bool wasSortedFromCache() { return sortedFromCache; };
+		void clearCache() { previousOrder.clear(); };
+
+		// all of these should be set from the projector before sorting
+		ofxLaserPathOrderMode mode = OFXLASER_PATH_ORDER_GREEDY;
+		int budgetMicros = 1000;
+		bool useCache = false;
+		ofPoint startPosition;
+		bool returnToStart = true;
+		float moveSpeed = 5;
+		int shapeBlankPoints = 0; // pre and post blank / on points per move
+
+		protected :
+
+		void sortGreedy(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints);
+		bool twoOpt(vector<ShapePoints*>& path, uint64_t endTime);
+		bool orOpt(vector<ShapePoints*>& path, uint64_t endTime);
+		void reverseSection(vector<ShapePoints*>& path, int first, int last);
+
+		bool sortFromCache(vector<ShapePoints>& shapepoints, vector<ShapePoints*>& sortedshapepoints);
+		void insertSegment(vector<ShapePoints*>& path, ShapePoints* segment);
+		void storeCache(vector<ShapePoints*>& path);
+		uint64_t getGeometryKey(ShapePoints& segment);
+
+		struct CacheEntry {
+			uint64_t geometryKey;
+			uint64_t identity;
+			bool reversed;
+		};
+		vector<CacheEntry> previousOrder;
+		vector<int> previousMatches;
+		vector<bool> matched;
+		unordered_multimap<uint64_t, int> geometryLookup;
+		unordered_map<uint64_t, int> identityLookup;
+		// segment ends are rounded to this many units in projector space
+		// before comparing the geometry
+		float cacheTolerance = 4;
+		bool sortedFromCache = false;
+		// how often (in frames) we check the cached order against a new
+		// nearest neighbour sort
+		int greedyCheckInterval = 30;
+		int framesSinceGreedyCheck = 0;
+		vector<ShapePoints*> greedyOrder;
+		vector<bool> cachedReversed;
+
+		ShapePointsIndex shapePointsIndex;
+		vector<int> nonReversableCount;
+		vector<ShapePoints*> chain;
+
+		int blankPoints = 0;
+		int blankPointsSaved = 0;
+
+	};
+}
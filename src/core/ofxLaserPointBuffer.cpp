@@ -0,0 +1,82 @@
+//
+//  ofxLaserPointBuffer.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserPointBuffer.h"
+
+using namespace ofxLaser;
+
+void PointBuffer :: clear() {
+	// clear keeps the capacity so we don't reallocate every frame
+	x.clear();
+	y.clear();
+	r.clear();
+	g.clear();
+	b.clear();
+	flags.clear();
+}
+
+void PointBuffer :: reserve(size_t numpoints) {
+	x.reserve(numpoints);
+	y.reserve(numpoints);
+	r.reserve(numpoints);
+	g.reserve(numpoints);
+	b.reserve(numpoints);
+	flags.reserve(numpoints);
+}
+
+void PointBuffer :: resize(size_t numpoints) {
+	x.resize(numpoints);
+	y.resize(numpoints);
+	r.resize(numpoints);
+	g.resize(numpoints);
+	b.resize(numpoints);
+	flags.resize(numpoints);
+}
+
+void PointBuffer :: push_back(const Point& p) {
+	addPoint(p.x, p.y, p.r, p.g, p.b, p.useCalibration);
+}
+
+void PointBuffer :: addPoint(float px, float py, float pr, float pg, float pb, bool usecalibration) {
+	x.push_back(px);
+	y.push_back(py);
+	r.push_back(pr);
+	g.push_back(pg);
+	b.push_back(pb);
+	flags.push_back(usecalibration ? FLAG_USE_CALIBRATION : 0);
+}
+
+Point PointBuffer :: getPoint(int index) const {
+	Point p;
+	p.x = x[index];
+	p.y = y[index];
+	p.r = r[index];
+	p.g = g[index];
+	p.b = b[index];
+	p.useCalibration = (flags[index] & FLAG_USE_CALIBRATION)!=0;
+	return p;
+}
+
+void PointBuffer :: copyFrom(const vector<Point>& points) {
+	resize(points.size());
+	for(int i = 0; i<points.size(); i++) {
+		const Point& p = points[i];
+		x[i] = p.x;
+		y[i] = p.y;
+		r[i] = p.r;
+		g[i] = p.g;
+		b[i] = p.b;
+		flags[i] = p.useCalibration ? FLAG_USE_CALIBRATION : 0;
+	}
+}
+
+void PointBuffer :: copyTo(vector<Point>& points) const {
+	points.resize(size());
+	for(int i = 0; i<points.size(); i++) {
+		points[i] = getPoint(i);
+	}
+}
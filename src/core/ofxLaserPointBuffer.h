@@ -0,0 +1,53 @@
+//
+//  ofxLaserPointBuffer.h
+//  ofxLaser
+//
+//
+//
+
+#pragma once
+#include "ofxLaserPoint.h"
+
+namespace ofxLaser {
+
+	// All the points for a frame, with each property in its own array rather
+	// than a vector of Points. That way the processing for each point and the
+	// conversion in the DACs just run through contiguous memory.
+	// Positions are in projector space (0-800) and colours are 0-255, the
+	// same as Point. Point's intensity isn't stored because nothing after
+	// the shapes uses it.
+	class PointBuffer {
+
+		public :
+
+		enum {
+			FLAG_USE_CALIBRATION = 1
+		};
+
+		size_t size() const { return x.size(); };
+		bool empty() const { return x.empty(); };
+		void clear();
+		void reserve(size_t numpoints);
+		void resize(size_t numpoints);
+
+		void push_back(const Point& p);
+		void addPoint(float px, float py, float pr, float pg, float pb, bool usecalibration = true);
+
+		Point getPoint(int index) const;
+		ofColor getColour(int index) const {
+			return ofColor(r[index], g[index], b[index]);
+		}
+
+		// adapters for code that still uses vectors of Points
+		void copyFrom(const vector<Point>& points);
+		void copyTo(vector<Point>& points) const;
+
+		vector<float> x;
+		vector<float> y;
+		vector<float> r;
+		vector<float> g;
+		vector<float> b;
+		vector<uint8_t> flags;
+
+	};
+}
@@ -0,0 +1,146 @@
+//
+//  ofxLaserPointKernels.cpp
+//  ofxLaser
+//
+//
+//
+
+// The results have to be exactly the same as the old point by point
+// code, so the compiler mustn't turn any of the multiplies and adds into
+// fused multiply-adds (which it will if it's allowed to use FMA, eg with
+// -march=native). This is the same as -ffp-contract=off for this file.
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
+#include "ofxLaserPointKernels.h"
+#include "SimdUtils.h"
+
+using namespace ofxLaser;
+using namespace ofxLaser::simd;
+
+void ofxLaser :: transformPoints(PointBuffer& points, bool flipX, bool flipY, bool rotate, float angle) {
+
+	int numpoints = points.size();
+
+	const float4 zero = set(0);
+	const float4 size = set(800);
+	const float4 centre = set(400);
+	// the same values that glm::rotate ends up with for a rotation around z
+	const float4 cosAngle = set(std::cos(angle));
+	const float4 sinAngle = set(std::sin(angle));
+	const float4 negSinAngle = set(-std::sin(angle));
+
+	auto process = [&](float* xs, float* ys, float* rs, float* gs, float* bs) {
+		float4 x = load(xs);
+		float4 y = load(ys);
+
+		if(flipY) y = sub(size, y);
+		if(flipX) x = sub(size, x);
+		if(rotate) {
+			x = sub(x, centre);
+			y = sub(y, centre);
+			float4 rotatedx = add(mul(cosAngle, x), mul(negSinAngle, y));
+			float4 rotatedy = add(mul(sinAngle, x), mul(cosAngle, y));
+			x = add(rotatedx, centre);
+			y = add(rotatedy, centre);
+		}
+
+		// bounds check, blank anything that's off the edge
+		mask4 outside = maskOr(maskOr(lessThan(x, zero), greaterThan(x, size)),
+							   maskOr(lessThan(y, zero), greaterThan(y, size)));
+		store(xs, clamp(x, zero, size));
+		store(ys, clamp(y, zero, size));
+		store(rs, select(outside, zero, load(rs)));
+		store(gs, select(outside, zero, load(gs)));
+		store(bs, select(outside, zero, load(bs)));
+	};
+
+	int i = 0;
+	for(; i+4<=numpoints; i+=4) {
+		process(&points.x[i], &points.y[i], &points.r[i], &points.g[i], &points.b[i]);
+	}
+
+	// copy any left over points into a full set of 4 so we don't need
+	// a separate version for them
+	int remaining = numpoints-i;
+	if(remaining>0) {
+		float x[4] = {}, y[4] = {}, r[4] = {}, g[4] = {}, b[4] = {};
+		for(int j = 0; j<remaining; j++) {
+			x[j] = points.x[i+j];
+			y[j] = points.y[i+j];
+			r[j] = points.r[i+j];
+			g[j] = points.g[i+j];
+			b[j] = points.b[i+j];
+		}
+		process(x, y, r, g, b);
+		for(int j = 0; j<remaining; j++) {
+			points.x[i+j] = x[j];
+			points.y[i+j] = y[j];
+			points.r[i+j] = r[j];
+			points.g[i+j] = g[j];
+			points.b[i+j] = b[j];
+		}
+	}
+}
+
+void ofxLaser :: calibrateColours(float* values, const uint8_t* flags, int count, const CalibrationTable& table) {
+
+	const vector<CalibrationTable::Segment>& segments = table.getSegments();
+	int numsegments = segments.size();
+	if(numsegments==0) return;
+
+	const float4 zero = set(0);
+	const float4 maxValue = set(255.0f);
+	const float4 intensity = set(table.getIntensity());
+	const float4 threshold = set(CalibrationTable::getThreshold());
+
+	auto process = [&](float* vs, const uint8_t* fs) {
+		float4 original = load(vs);
+		float4 value = mul(div(original, maxValue), intensity);
+
+		// pick the line for each point without branching, it's the last
+		// one that starts before the value
+		const CalibrationTable::Segment& first = segments[0];
+		float4 start = set(first.start);
+		float4 size = set(first.size);
+		float4 from = set(first.from);
+		float4 change = set(first.change);
+		for(int i = 1; i<numsegments; i++) {
+			const CalibrationTable::Segment& segment = segments[i];
+			mask4 after = greaterOrEqual(value, set(segment.start));
+			start = select(after, set(segment.start), start);
+			size = select(after, set(segment.size), size);
+			from = select(after, set(segment.from), from);
+			change = select(after, set(segment.change), change);
+		}
+
+		// same as ofMap(value, start, end, from, to) * 255
+		float4 result = mul(add(mul(div(sub(value, start), size), change), from), maxValue);
+		result = select(lessThan(value, threshold), zero, result);
+
+		store(vs, select(flagsSet(fs, PointBuffer::FLAG_USE_CALIBRATION), result, original));
+	};
+
+	int i = 0;
+	for(; i+4<=count; i+=4) {
+		process(values+i, flags+i);
+	}
+	int remaining = count-i;
+	if(remaining>0) {
+		float v[4] = {};
+		uint8_t f[4] = {};
+		for(int j = 0; j<remaining; j++) {
+			v[j] = values[i+j];
+			f[j] = flags[i+j];
+		}
+		process(v, f);
+		for(int j = 0; j<remaining; j++) {
+			values[i+j] = v[j];
+		}
+	}
+}
@@ -0,0 +1,26 @@
+//
+//  ofxLaserPointKernels.h
+//  ofxLaser
+//
+//
+//
+//  The per point processing that happens to every frame just before it
+//  goes to the DAC. These work on 4 points at a time (see SimdUtils.h) and
+//  give exactly the same results as the old point by point code.
+
+#pragma once
+#include "ofxLaserPointBuffer.h"
+#include "ofxLaserCalibrationTable.h"
+
+namespace ofxLaser {
+
+	// flips and rotates (around the centre) all the points, then clamps
+	// them to the 0-800 projector space. Any point that had to be clamped
+	// is blanked.
+	void transformPoints(PointBuffer& points, bool flipX, bool flipY, bool rotate, float angle);
+
+	// applies the colour calibration to one colour channel, for the points
+	// that have FLAG_USE_CALIBRATION set (CalibrationTable::apply uses this)
+	void calibrateColours(float* values, const uint8_t* flags, int count, const CalibrationTable& table);
+
+}
@@ -7,6 +7,7 @@
 //
 
 #include "ofxLaserProjector.h"
+#include "ofxLaserPointKernels.h"
 #include "ofxLaserManager.h"
 
 using namespace ofxLaser;
@@ -72,9 +73,19 @@ void Projector :: initGui(bool showAdvanced) {
 		advanced.add(smoothHomePosition.set("Smooth home position", true));
 		advanced.add(targetFramerate.set("Target framerate (experimental)", 25, 23, 35));
 		advanced.add(syncToTargetFramerate.set("Sync to Target framerate", false));
+		// 0 : nearest neighbour, 1 : plus 2-opt, 2 : plus or-opt
+		advanced.add(pathOrderMode.set("Path optimisation", OFXLASER_PATH_ORDER_GREEDY, OFXLASER_PATH_ORDER_GREEDY, OFXLASER_PATH_ORDER_OROPT));
+		advanced.add(pathOrderBudget.set("Path optimisation time (us)", 1000, 0, 5000));
+		advanced.add(pathOrderCache.set("Keep path order between frames", false));
+		advanced.add(pathBlankPointsSaved.set("Blank points saved", 0, 0, 1000));
 		projectorparams.add(advanced);
 	}
-	else speedMultiplier = 1;
+	else {
+		speedMultiplier = 1;
+		pathOrderMode = OFXLASER_PATH_ORDER_GREEDY;
+		pathOrderBudget = 1000;
+		pathOrderCache = false;
+	}
 	
 	//gui->add(projectorparams);
 	params.add(projectorparams);
@@ -219,6 +230,9 @@ void Projector :: minimiseGui() {
 Projector::~Projector() {
 	ofLog(OF_LOG_NOTICE, "ofxLaser::Projector destructor called");
 	pps.removeListener(this, &Projector::ppsChanged);
+	for(deque<Shape*>& shapes : zoneTestPatternShapes) {
+		for(Shape* shape : shapes) delete shape;
+	}
 	delete gui;
 }
 
@@ -486,8 +500,7 @@ void Projector :: drawLaserPath(float x, float y, float w, float h) {
 		ofSetColor(255);
 		ofDrawCircle(p, 3);
 		ofFill();
-		Point& lp =laserPoints[pointindex];
-		ofSetColor(lp.getColour()*255);
+		ofSetColor(laserPoints.getColour(pointindex)*255);
 		ofDrawCircle(p, 3);
 	}
     
@@ -567,8 +580,11 @@ void Projector::update(bool updateZones) {
         }
     }
     
-	laserPoints.clear();
-	previewPathMesh.clear();
+	// keep the points for the preview if we're not sending a new frame
+	if(frameDue) {
+		laserPoints.clear();
+		previewPathMesh.clear();
+	}
 	for(int i = 0; i<zoneTransforms.size(); i++) {
 		zoneTransforms[i]->update();
 	}
@@ -590,6 +606,10 @@ void Projector::sendRawPoints(const vector<ofxLaser::Point>& points, int zonenum
     
     //ofLog(OF_LOG_NOTICE, "ofxLaser::Projector::sendRawPoints(...) point count : "+ofToString(points.size()));
     
+    // these get sent straight away so only keep this lot. update()
+    // doesn't clear them if the DAC doesn't need a frame (pull mode)
+    laserPoints.clear();
+    
     Zone& zone = *zones.at(zonenum);
     ofRectangle& maskRectangle = zoneMasks.at(zonenum);
     ZoneTransform& warp = *zoneTransforms.at(zonenum);
@@ -647,14 +667,45 @@ void Projector::sendRawPoints(const vector<ofxLaser::Point>& points, int zonenum
     
     // go through all the points and warp them into projector space
     
+    warp.warpPoints(segmentpoints.data(), segmentpoints.size());
     for(int k= 0; k<segmentpoints.size(); k++) {
-        addPoint(warp.getWarpedPoint(segmentpoints[k]));
+        addPoint(segmentpoints[k]);
     }
     
     processPoints(masterIntensity, false);
     dac->sendPoints(laserPoints);
 }
 
+void Projector::prepareSend() {
+	
+	// the test pattern shapes have to be made on the main thread
+	// because Circle uses the openGL matrices
+	zoneTestPatternShapes.resize(zones.size());
+	for(int i = 0; i<zones.size(); i++) {
+		for(Shape* shape : zoneTestPatternShapes[i]) delete shape;
+		zoneTestPatternShapes[i] = getTestPatternShapesForZone(i);
+	}
+	
+	// from the last send, it's updated here so that the GUI only
+	// ever gets changed from the main thread
+	pathBlankPointsSaved = pathOptimiser.getBlankPointsSaved();
+	
+	sendPrepared = true;
+}
+
+bool Projector::isFrameDue(float leadmillis, float appframemillis) {
+	
+	// it hasn't picked up the last one yet
+	if(dac->isFrameWaiting()) return false;
+	
+	// the DAC can't tell, so it gets one every time
+	int64_t untilneeded = dac->getMicrosUntilFrameNeeded();
+	if(untilneeded<0) return true;
+	
+	// would it be too late if we waited for the next app frame?
+	return untilneeded < (leadmillis+appframemillis)*1000;
+}
+
 void Projector::send(ofPixels* pixels, float masterIntensity) {
     
 	if(!guiInitialised) {
@@ -662,6 +713,16 @@ void Projector::send(ofPixels* pixels, float masterIntensity) {
 		return;
 	}
 	
+	// the DAC doesn't need a frame yet (pull mode)
+	if(!frameDue) {
+		sendPrepared = false;
+		return;
+	}
+	
+	// if we're not being called from the Manager
+	if(!sendPrepared) prepareSend();
+	sendPrepared = false;
+	
 	vector<ShapePoints> allzoneshapepoints;
     
 	// TODO add speed multiplier to getPointsForMove function
@@ -671,44 +732,14 @@ void Projector::send(ofPixels* pixels, float masterIntensity) {
 	
 	// sort the point objects
 	if(allzoneshapepoints.size()>0) {
-		bool reversed = false;
-		int currentIndex = 0;
-		float shortestDistance = INFINITY;
-		int nextDotIndex = -1;
-        
-		do {
-			ShapePoints& shapePoints1 = allzoneshapepoints[currentIndex];
-			
-			shapePoints1.tested = true;
-			sortedshapepoints.push_back(&shapePoints1);
-			shapePoints1.reversed = reversed;
-			
-			shortestDistance = INFINITY;
-			nextDotIndex = -1;
-			
-			for(int j = 0; j<allzoneshapepoints.size(); j++) {
-				
-				ShapePoints& shapePoints2 = allzoneshapepoints[j];
-				if((&shapePoints1==&shapePoints2) || (shapePoints2.tested)) continue;
-				
-				shapePoints2.reversed = false;
-				
-				if(shapePoints1.getEnd().squareDistance(shapePoints2.getStart()) < shortestDistance) {
-					shortestDistance = shapePoints1.getEnd().squareDistance(shapePoints2.getStart());
-					nextDotIndex = j;
-					reversed = false;
-				}
-				
-				if((shapePoints2.reversable) && (shapePoints1.getEnd().squareDistance(shapePoints2.getEnd()) < shortestDistance)) {
-					shortestDistance = shapePoints1.getEnd().squareDistance(shapePoints2.getEnd());
-					nextDotIndex = j;
-					reversed = true;
-				}
-			}
-			
-			currentIndex = nextDotIndex;
-		}
-        while (currentIndex>-1);
+		pathOptimiser.mode = (ofxLaserPathOrderMode)(int)pathOrderMode;
+		pathOptimiser.budgetMicros = pathOrderBudget;
+		pathOptimiser.useCache = pathOrderCache;
+		pathOptimiser.startPosition = laserHomePosition;
+		pathOptimiser.returnToStart = smoothHomePosition;
+		pathOptimiser.moveSpeed = moveSpeed*speedMultiplier;
+		pathOptimiser.shapeBlankPoints = shapePreBlank + shapePreOn + shapePostOn + shapePostBlank;
+		pathOptimiser.sort(allzoneshapepoints, sortedshapepoints);
         
 		// go through the point objects
 		// add move between each one
@@ -800,12 +831,14 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 		deque<Shape*> zoneshapes = zone.shapes;
 		
 		// add testpattern points for this zone...
-		// get array of segmentpoints and append them
-		deque<Shape*> testPatternShapes = getTestPatternShapesForZone(i);
+		// they were made in prepareSend()
+		deque<Shape*>& testPatternShapes = zoneTestPatternShapes[i];
 		
 		zoneshapes.insert(zoneshapes.end(), testPatternShapes.begin(), testPatternShapes.end());
 		
 		zoneshapepoints.clear();
+		// how many of each kind of shape we've had in this zone
+		shapeKeyCounts.clear();
 		
 		// go through each shape in the zone
 		
@@ -819,9 +852,17 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 			shapepoints.clear();
 			shape.appendPointsToVector(shapepoints, renderProfile, speedmultiplier);
 			
+			// the shapes are made again every frame so we can't use
+			// anything about the object itself to identify it, and its
+			// position in the list changes if shapes are added or removed
+			// in front of it. So it's the nth shape of its kind instead.
+			uint64_t shapekey = getShapeKey(shape);
+			shapekey += (uint64_t)(shapeKeyCounts[shapekey]++)*0xc2b2ae3d27d4eb4full;
+			
 			bool offScreen = true;
 			
 			ShapePoints segmentpoints;
+			int segmentnum = 0;
 			
 			//iterate through the points
 			for(int k = 0; k<shapepoints.size(); k++) {
@@ -848,6 +889,7 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 							segmentpoints.push_back(lastpoint);
 							
 							// add this bunch to the collection
+							segmentpoints.setIdentity(i, shapekey, segmentnum++);
 							zoneshapepoints.push_back(segmentpoints); // should copy
 							
 							//clear the vector and start again
@@ -877,6 +919,7 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 			} // end shapepoints
 			// add the segment points to the points for the zone
 			if(segmentpoints.size()>0) {
+				segmentpoints.setIdentity(i, shapekey, segmentnum++);
 				zoneshapepoints.push_back(segmentpoints);
 			}
 			
@@ -885,10 +928,10 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 		// go through all the points and warp them into projector space
 		for(int j = 0; j<zoneshapepoints.size(); j++) {
 			ShapePoints& segmentpoints = zoneshapepoints[j];
-			for(int k= 0; k<segmentpoints.size(); k++) {
-				
-				// Check against the mask image
-				if(pixels!=NULL) {
+			
+			// Check against the mask image
+			if(pixels!=NULL) {
+				for(int k= 0; k<segmentpoints.size(); k++) {
 					Point& p = segmentpoints[k];
 					ofFloatColor c = pixels->getColor(p.x, p.y);
 					float brightness = c.getBrightness();
@@ -896,9 +939,9 @@ void Projector ::getAllShapePoints(vector<ShapePoints>* shapepointscontainer, of
 					p.g*=brightness;
 					p.b*=brightness;
 				}
-				
-				segmentpoints[k] = warp.getWarpedPoint(segmentpoints[k]);
 			}
+			
+			warp.warpPoints(segmentpoints.data(), segmentpoints.size());
 		}
 		
 		// add all the segments for the zone into the big container for all the segs
@@ -922,6 +965,17 @@ RenderProfile& Projector::getRenderProfile(string profilelabel) {
     return renderProfiles.at(profilelabel);
 }
 
+uint64_t Projector :: getShapeKey(Shape& shape) {
+	
+	ofFloatColor& colour = shape.getColour();
+	uint64_t key = typeid(shape).hash_code();
+	key = key*31 + std::hash<string>()(shape.profileLabel);
+	key = key*31 + std::hash<float>()(colour.r);
+	key = key*31 + std::hash<float>()(colour.g);
+	key = key*31 + std::hash<float>()(colour.b);
+	return key;
+}
+
 deque<Shape*> Projector ::getTestPatternShapesForZone(int zoneindex) {
 	
 	deque<Shape*> shapes;
@@ -1135,141 +1189,88 @@ void  Projector :: processPoints(float masterIntensity, bool offsetColours) {
     
 	// Some lasers change colour too early/late, so the colourChangeOffset system
 	// mitigates against that by shifting the colours for the points.
-	// Some optimisation makes this slightly hard to read but we iterate through
-	// the points forwards or backwards depending on which direction we have to shift.
-	// To avoid creating a whole new vector, we're storing the overlap in a buffer of
-	// colours.
-	// I'm sure there must be some slicker C++ way of doing this...
-	
-	if(offsetColours) {
-	// the offset value is in time, so we convert it to a number of points.
+	// Because the colours and positions are in separate arrays, we can
+	// just shift the whole array for the colours (or for the positions
+	// if we're going the other way).
+	
+	int numpoints = laserPoints.size();
+	
+	if(offsetColours && (numpoints>0)) {
+		// the offset value is in time, so we convert it to a number of points.
 		// this way we can change the PPS and this should still work
 		int colourChangeIndexOffset = (float)pps/10000.0f*colourChangeOffset ;
 		
 		// if >0 then we change the colour later, ie we shift the colours forward
-        
+		
 		if(colourChangeIndexOffset>0) {
 			
-			// add some points to the end of the vector to allow for the offset
-			laserPoints.resize(laserPoints.size()+colourChangeIndexOffset);
-			for(int i = laserPoints.size()-1; i>=0; i--) {
-				Point& p = laserPoints[i];
-				
-				// if we're one of the new points at the end copy the position
-				// from the last point
-				if(i>=laserPoints.size()-colourChangeIndexOffset) {
-					// copy the last positino in the original array
-					
-					p = laserPoints[laserPoints.size()-1-colourChangeIndexOffset];
-					//cout << (laserPoints.size()-1-colourChangeOffset) << " " << p << endl;
-				}
-                
-				//now shift the colour from an earlier point
-				if(i>=colourChangeIndexOffset){
-					p.copyColourFromPoint(laserPoints[i-colourChangeIndexOffset]);
-				} else {
-					p.setColour(0,0,0);
-				}
+			// add some points to the end to allow for the offset, they
+			// get the position of the last point
+			laserPoints.resize(numpoints+colourChangeIndexOffset);
+			for(int i = numpoints; i<laserPoints.size(); i++) {
+				laserPoints.x[i] = laserPoints.x[numpoints-1];
+				laserPoints.y[i] = laserPoints.y[numpoints-1];
+				laserPoints.flags[i] = laserPoints.flags[numpoints-1];
 			}
-		} else {
+			// now shift the colours forward and blank the start
+			for(vector<float>* channel : {&laserPoints.r, &laserPoints.g, &laserPoints.b}) {
+				float* c = channel->data();
+				memmove(c+colourChangeIndexOffset, c, numpoints*sizeof(float));
+				std::fill(c, c+colourChangeIndexOffset, 0.0f);
+			}
+		} else if(colourChangeIndexOffset<0) {
 			
-			// if we're <0 then we shift the colours backward
+			// if we're <0 then we shift the colours backward, which is the
+			// same as shifting the positions forward
 			
 			// change negative to positive
 			colourChangeIndexOffset*=-1;
 			
-			laserPoints.resize(laserPoints.size()+colourChangeIndexOffset);
+			laserPoints.resize(numpoints+colourChangeIndexOffset);
 			
-			for(int i = laserPoints.size()-1; i>=0; i--) {
-				Point& p = laserPoints[i];
-				
-				ofColor c(0,0,0);
-				if(i<laserPoints.size()-colourChangeIndexOffset) c = p.getColour();
-				if(i>=colourChangeIndexOffset) {
-					p = laserPoints[i-colourChangeIndexOffset];
-				} else {
-					p= laserPoints[colourChangeIndexOffset];
-				}
-				p.setColour(c.r, c.g, c.b);
+			// the new points at the start get the position of the first point
+			// and the new points at the end are blank
+			for(vector<float>* channel : {&laserPoints.x, &laserPoints.y}) {
+				float* v = channel->data();
+				memmove(v+colourChangeIndexOffset, v, numpoints*sizeof(float));
+				std::fill(v, v+colourChangeIndexOffset, v[colourChangeIndexOffset]);
 			}
-		}
-	}
-    
-	for(int i = 0; i<laserPoints.size(); i++) {
-		
-		ofxLaser::Point &p = laserPoints[i];
-        
-		if(flipY) p.y= 800-p.y;
-		if(flipX) p.x= 800-p.x;
-		if(abs(rotation)>0.5) {
-			p.x-=400;
-			p.y-=400;
-//			glm::vec3 v(p.x, p.y, 0);
-//			glm::vec3 axis(0.0f,0.0f,1.0f);
-//			v = glm::rotate(v,1.0f, axis);
-			auto vec = glm::vec3(p.x,p.y,0.0f);
-			float angle = ofDegToRad(rotation); // since glm version 0.9.6, rotations are in radians, not in degrees
+			uint8_t* flags = laserPoints.flags.data();
+			memmove(flags+colourChangeIndexOffset, flags, numpoints);
+			std::fill(flags, flags+colourChangeIndexOffset, flags[colourChangeIndexOffset]);
 			
-			//cout << vec << endl;
-			auto rotatedVec = glm::rotate(vec, angle, glm::vec3(0.0f, 0.0f, 1.0f));
-			p.x=rotatedVec.x+400;
-			p.y=rotatedVec.y+400;
-		}
-		
-		// bounds check
-		if(p.x<0) p.x = p.r = p.g = p.b = 0;
-		else if(p.x>800) {
-			p.x = 800;
-			p.r = p.g = p.b = 0;
-		}
-		if(p.y<0) p.y = p.r = p.g = p.b = 0;
-		else if(p.y>800) {
-			p.y = 800;
-			p.r = p.g = p.b = 0;
-		}
-		
-//		if(showPostTransformPreview){
-//			ofPoint previewpoint(p.x, p.y);
-//			previewPathMesh.addVertex(previewpoint);
-//		}
-		
-//		ofFloatColor c(p.r / 255.0f, p.g / 255.0f, p.b / 255.0f);
-//		if(useMaskBitmap) {
-//			c.r*=((float)maskPixelColour.r/255.0);
-//			c.g*=((float)maskPixelColour.g/255.0);
-//			c.b*=((float)maskPixelColour.b/255.0);
-//		}
-		
-		if(p.useCalibration) {
-			p.r = calculateCalibratedBrightness(p.r, intensity*masterIntensity, red100, red75, red50, red25, red0);
-			p.g = calculateCalibratedBrightness(p.g, intensity*masterIntensity, green100, green75, green50, green25, green0);
-			p.b = calculateCalibratedBrightness(p.b, intensity*masterIntensity, blue100, blue75, blue50, blue25, blue0);
+			// colours are already in the right place, resize leaves
+			// the new ones at the end as 0
 		}
+		numpoints = laserPoints.size();
+	}
+	
+	transformPoints(laserPoints, flipX, flipY, abs(rotation)>0.5, ofDegToRad(rotation));
+	
+	if(armed) {
+		// the tables only get rebuilt if the calibration or intensity changes
+		float brightness = intensity*masterIntensity;
+		calibrationLevels = {red0, red25, red50, red75, red100};
+		redCalibration.update(calibrationLevels, brightness);
+		calibrationLevels = {green0, green25, green50, green75, green100};
+		greenCalibration.update(calibrationLevels, brightness);
+		calibrationLevels = {blue0, blue25, blue50, blue75, blue100};
+		blueCalibration.update(calibrationLevels, brightness);
 		
-		if(!armed) {
-			p.r = 0;
-			p.g = 0;
-			p.b = 0;
-		}
-        
-        //ildaPoints.push_back(ofxIlda::Point(p, c, pmin, pmax));
+		const uint8_t* flags = laserPoints.flags.data();
+		redCalibration.apply(laserPoints.r.data(), flags, numpoints);
+		greenCalibration.apply(laserPoints.g.data(), flags, numpoints);
+		blueCalibration.apply(laserPoints.b.data(), flags, numpoints);
+	} else {
+		std::fill(laserPoints.r.begin(), laserPoints.r.end(), 0.0f);
+		std::fill(laserPoints.g.begin(), laserPoints.g.end(), 0.0f);
+		std::fill(laserPoints.b.begin(), laserPoints.b.end(), 0.0f);
 	}
 }
 
 float Projector::calculateCalibratedBrightness(float value, float intensity, float level100, float level75, float level50, float level25, float level0){
-	value/=255.0f;
-	value *=intensity;
-	if(value<0.001) {
-		return 0;
-	} else if(value<0.25) {
-		return ofMap(value, 0, 0.25, level0, level25) *255;
-	} else if(value<0.5) {
-		return ofMap(value, 0.25, 0.5,level25, level50) *255;
-	} else if(value<0.75) {
-		return ofMap(value, 0.5, 0.75,level50, level75) *255;
-	} else {
-		return ofMap(value, 0.75, 1,level75, level100) *255;
-	}
+	float levels[5] = {level0, level25, level50, level75, level100};
+	return CalibrationTable::calculateLevel(value, intensity, levels, 5);
 }
 
 void Projector::saveSettings(){
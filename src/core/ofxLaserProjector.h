@@ -13,28 +13,15 @@
 #include "ofxLaserZoneTransform.h"
 #include "ofxLaserRenderProfile.h"
 #include "ofxLaserManualShape.h"
+#include "ofxLaserShapePoints.h"
+#include "ofxLaserPathOptimiser.h"
+#include "ofxLaserPointBuffer.h"
+#include "ofxLaserCalibrationTable.h"
 #include "ofxGui.h"
 #include "PennerEasing.h"
 
 namespace ofxLaser {
     
-	// a container than holds all the points for a shape
-	class ShapePoints : public vector<Point> {
-		
-		public:
-        
-		bool tested = false;
-		bool reversed = false;
-		bool reversable = true;
-		Point& getStart() {
-			return reversed?this->back() : this->front();
-		}
-		Point& getEnd() {
-			return reversed?this->front() : this->back();
-		}
-        
-	};
-    
 	class Projector {
         
 		public :
@@ -47,7 +34,16 @@ namespace ofxLaser {
         bool mousePressed(ofMouseEventArgs &e);
 		
 		void update(bool updateZones);
+		// anything that has to happen on the main thread before send, which
+		// may be called from one of the Manager's render threads
+		void prepareSend();
 		void send(ofPixels* pixels = NULL, float masterIntensity = 1);
+		// for the Manager's pull mode, true if the DAC will need a frame
+		// before we get another chance to send one
+		bool isFrameDue(float leadmillis, float appframemillis);
+		// if it's false, update() keeps the last frame and send() doesn't
+		// render anything
+		bool frameDue = true;
 		void getAllShapePoints(vector<ShapePoints>* allzoneshapepoints, ofPixels*pixels, float speedmultiplier);
         
         void sendRawPoints(const vector<Point>& points, int zonenum = 0, float masterIntensity =1);
@@ -86,11 +82,19 @@ namespace ofxLaser {
 		void minimiseGui();
 		
 		deque<Shape*> getTestPatternShapesForZone(int zoneindex);
+		// the projector uses its CalibrationTables now, this is the same
+		// thing for anything else that wants it
 		float calculateCalibratedBrightness(float value, float intensity, float level100, float level75, float level50, float level25, float level0);
+		// made from the things about a shape that don't change as it
+		// moves - what kind of shape it is, its colour and its profile
+		uint64_t getShapeKey(Shape& shape);
+		unordered_map<uint64_t, int> shapeKeyCounts;
         
 		vector<Zone*> zones;
 		vector<ZoneTransform*> zoneTransforms;
 		vector<ofRectangle> zoneMasks;
+		vector<deque<Shape*>> zoneTestPatternShapes;
+		bool sendPrepared = false;
 		
 		vector<ofParameter<float>>leftEdges;
 		vector<ofParameter<float>>rightEdges;
@@ -109,9 +113,10 @@ namespace ofxLaser {
 		const int max = 32767;
 		
 		ofPoint laserHomePosition;
+		PathOptimiser pathOptimiser;
 		string label;
 		float smoothedFrameRate = 0; 
-		vector<Point> laserPoints;
+		PointBuffer laserPoints;
         int numPoints;
 		ofMesh previewPathMesh;
 		
@@ -140,6 +145,10 @@ namespace ofxLaser {
 		ofParameter<int> shapePostOn = 0;
 		
 		ofParameter<bool> smoothHomePosition;
+		ofParameter<int> pathOrderMode;
+		ofParameter<int> pathOrderBudget;
+		ofParameter<bool> pathOrderCache;
+		ofParameter<int> pathBlankPointsSaved;
         
 		ofParameter<bool> laserOnWhileMoving = false;
 		
@@ -168,6 +177,11 @@ namespace ofxLaser {
 		ofParameter<float>blue25;
 		ofParameter<float>blue0;
 		
+		CalibrationTable redCalibration;
+		CalibrationTable greenCalibration;
+		CalibrationTable blueCalibration;
+		vector<float> calibrationLevels;
+		
 		ofxPanel* gui;
         //bool guiIsVisible;
 		bool guiInitialised = false;
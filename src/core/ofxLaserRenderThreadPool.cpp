@@ -0,0 +1,151 @@
+//
+//  ofxLaserRenderThreadPool.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserRenderThreadPool.h"
+
+#if defined(TARGET_LINUX)
+#include <pthread.h>
+#elif defined(TARGET_WIN32)
+#include <windows.h>
+#endif
+
+using namespace ofxLaser;
+
+RenderThreadPool :: ~RenderThreadPool() {
+	stop();
+}
+
+void RenderThreadPool :: run(int count, const std::function<void(int)>& job) {
+	
+	if(count<=0) return;
+	// not worth waking anything up for one job
+	if(count==1) {
+		job(0);
+		return;
+	}
+	
+	// the calling thread does one of the jobs so we need one less thread
+	int numthreads = count-1;
+	if((threads.size()!=numthreads) || (pinToCores!=threadsPinned)) {
+		stop();
+		start(numthreads);
+	}
+	
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentJob = job;
+		jobCount = count;
+		nextJob = 0;
+		jobsRemaining = count;
+		generation++;
+	}
+	jobsAvailable.notify_all();
+	
+	// help out rather than just waiting
+	while(doNextJob());
+	
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		jobsFinished.wait(lock, [this]{ return jobsRemaining==0; });
+		currentJob = nullptr;
+		std::swap(exception, jobException);
+	}
+	// pass it on as if we'd called the jobs one after another
+	if(exception) std::rethrow_exception(exception);
+}
+
+void RenderThreadPool :: stop() {
+	
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		exiting = true;
+	}
+	jobsAvailable.notify_all();
+	for(std::thread& thread : threads) {
+		if(thread.joinable()) thread.join();
+	}
+	threads.clear();
+	exiting = false;
+}
+
+void RenderThreadPool :: setPinToCores(bool pin) {
+	pinToCores = pin;
+}
+
+void RenderThreadPool :: start(int numthreads) {
+	
+	int numcores = std::thread::hardware_concurrency();
+	
+	for(int i = 0; i<numthreads; i++) {
+		threads.emplace_back(&RenderThreadPool::threadFunction, this, generation);
+		if(pinToCores && (numcores>1)) {
+			// leave core 0 for the main thread
+			int core = 1 + (i % (numcores-1));
+			if(!pinThreadToCore(threads.back(), core)) {
+				ofLogWarning("RenderThreadPool :: start - couldn't pin render thread to core "+ofToString(core));
+			}
+		}
+	}
+	threadsPinned = pinToCores;
+}
+
+void RenderThreadPool :: threadFunction(uint64_t startgeneration) {
+	
+	uint64_t lastgeneration = startgeneration;
+	
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobsAvailable.wait(lock, [&]{ return exiting || (generation!=lastgeneration); });
+			if(exiting) return;
+			lastgeneration = generation;
+		}
+		while(doNextJob());
+	}
+}
+
+bool RenderThreadPool :: doNextJob() {
+	
+	int index;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if(nextJob>=jobCount) return false;
+		index = nextJob++;
+	}
+	
+	// currentJob doesn't change until all the jobs are done so it's safe
+	// to call it outside the lock. If it throws it still has to count as
+	// done, otherwise run() would wait forever.
+	std::exception_ptr exception;
+	try {
+		currentJob(index);
+	} catch(...) {
+		exception = std::current_exception();
+	}
+	
+	std::lock_guard<std::mutex> lock(mutex);
+	if(exception && !jobException) jobException = exception;
+	jobsRemaining--;
+	if(jobsRemaining==0) jobsFinished.notify_all();
+	return true;
+}
+
+bool RenderThreadPool :: pinThreadToCore(std::thread& thread, int core) {
+	
+#if defined(TARGET_LINUX)
+	cpu_set_t cpuset;
+	CPU_ZERO(&cpuset);
+	CPU_SET(core, &cpuset);
+	return pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset)==0;
+#elif defined(TARGET_WIN32)
+	return SetThreadAffinityMask((HANDLE)thread.native_handle(), (DWORD_PTR)1<<core)!=0;
+#else
+	// macOS doesn't let you pin threads, only give the scheduler hints
+	return true;
+#endif
+}
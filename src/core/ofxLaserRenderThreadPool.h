@@ -0,0 +1,66 @@
+//
+//  ofxLaserRenderThreadPool.h
+//  ofxLaser
+//
+//
+//
+//  A small pool of worker threads that the Manager uses to render all the
+//  projectors at the same time. run(...) hands out one job per projector
+//  and doesn't return until they're all finished, so nothing else in the
+//  app has to know that there are threads involved.
+
+#pragma once
+
+#include "ofMain.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+namespace ofxLaser {
+
+	class RenderThreadPool {
+
+		public :
+
+		~RenderThreadPool();
+
+		// calls job(0) to job(count-1) across the worker threads (and the
+		// calling thread) and waits for them all to finish. If any of the
+		// jobs throw, the others still finish and then the first exception
+		// is thrown again from here.
+		void run(int count, const std::function<void(int)>& job);
+
+		// stops and joins all the threads, they're restarted by the next run
+		void stop();
+
+		// pinning each worker to its own core stops the OS moving them around
+		// mid frame. Only works on linux and windows, it's ignored elsewhere.
+		void setPinToCores(bool pin);
+
+		protected :
+
+		void start(int numthreads);
+		void threadFunction(uint64_t startgeneration);
+		// returns false when there are no jobs left
+		bool doNextJob();
+		bool pinThreadToCore(std::thread& thread, int core);
+
+		std::vector<std::thread> threads;
+		std::mutex mutex;
+		std::condition_variable jobsAvailable;
+		std::condition_variable jobsFinished;
+
+		std::function<void(int)> currentJob;
+		int jobCount = 0;
+		int nextJob = 0;
+		int jobsRemaining = 0;
+		std::exception_ptr jobException; // the first one that a job threw
+		uint64_t generation = 0; // increments every run so the workers know there's new work
+		bool exiting = false;
+
+		bool pinToCores = false;
+		bool threadsPinned = false;
+	};
+}
@@ -0,0 +1,44 @@
+//
+//  ofxLaserShapePoints.h
+//  ofxLaser
+//
+//
+//
+
+#pragma once
+#include "ofxLaserPoint.h"
+
+namespace ofxLaser {
+
+	// a container than holds all the points for a shape
+	class ShapePoints : public vector<Point> {
+
+		public:
+
+		bool tested = false;
+		bool reversed = false;
+		bool reversable = true;
+		// which zone, shape and segment within the shape this came from,
+		// used to match segments from one frame to the next
+		uint64_t identity = 0;
+		Point& getStart() {
+			return reversed?this->back() : this->front();
+		}
+		Point& getEnd() {
+			return reversed?this->front() : this->back();
+		}
+		// shapekey should be the same for the same shape every frame, even
+		// if it's moved, and not depend on where it is in the zone's list
+		// of shapes (see Projector::getShapeKey)
+		void setIdentity(int zoneindex, uint64_t shapekey, int segmentindex) {
+			// mix it all up (splitmix64) so similar shapes don't end up
+			// with similar identities
+			uint64_t z = shapekey + ((uint64_t)zoneindex<<32) + (uint64_t)segmentindex*0x9e3779b97f4a7c15ull;
+			z = (z ^ (z>>30)) * 0xbf58476d1ce4e5b9ull;
+			z = (z ^ (z>>27)) * 0x94d049bb133111ebull;
+			identity = z ^ (z>>31);
+		}
+
+	};
+
+}
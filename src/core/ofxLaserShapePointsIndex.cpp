@@ -0,0 +1,179 @@
+//
+//  ofxLaserShapePointsIndex.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserShapePointsIndex.h"
+
+using namespace ofxLaser;
+
+void ShapePointsIndex :: build(vector<ShapePoints>& shapepoints) {
+
+	shapePoints = &shapepoints;
+	numEntries = 0;
+
+	// figure out the bounds of all the end points
+	float right = 0;
+	float bottom = 0;
+	bool first = true;
+	for(ShapePoints& segment : shapepoints) {
+		if(segment.size()==0) continue;
+		Point& start = segment.front();
+		Point& end = segment.back();
+		if(first) {
+			left = right = start.x;
+			top = bottom = start.y;
+			first = false;
+		}
+		left = MIN(left, MIN(start.x, end.x));
+		right = MAX(right, MAX(start.x, end.x));
+		top = MIN(top, MIN(start.y, end.y));
+		bottom = MAX(bottom, MAX(start.y, end.y));
+	}
+
+	// aim for around 2 entries per cell
+	int numcells = MAX(1, (int)ceil(sqrt(shapepoints.size()/2.0f)));
+	cellSize = MAX(right-left, bottom-top) / numcells;
+	if(cellSize<=0) cellSize = 1;
+	numCols = MAX(1, (int)ceil((right-left)/cellSize));
+	numRows = MAX(1, (int)ceil((bottom-top)/cellSize));
+
+	// clear rather than reallocate so the cells keep their memory
+	// from frame to frame
+	if(cells.size()<numCols*numRows) cells.resize(numCols*numRows);
+	for(vector<Entry>& cell : cells) cell.clear();
+
+	for(int i = 0; i<shapepoints.size(); i++) {
+		ShapePoints& segment = shapepoints[i];
+		if(segment.size()==0) continue;
+		addEntry(i, false);
+		if(segment.reversable) addEntry(i, true);
+	}
+}
+
+void ShapePointsIndex :: remove(int index) {
+
+	ShapePoints& segment = shapePoints->at(index);
+	if(segment.size()==0) return;
+	removeEntry(index, false);
+	if(segment.reversable) removeEntry(index, true);
+}
+
+int ShapePointsIndex :: findNearest(const Point& position, bool& reversed) {
+
+	if(numEntries==0) return -1;
+
+	float shortestDistance = INFINITY;
+	int nearestIndex = -1;
+	bool nearestReversed = false;
+
+	int cellx = getCellX(position.x);
+	int celly = getCellY(position.y);
+
+	// small margin to make sure that float rounding in the cell
+	// calculation doesn't make us skip a point on a cell edge
+	float margin = cellSize*0.001f;
+
+	// search outwards from the cell the position is in, in rings.
+	for(int ring = 0; ; ring++) {
+
+		for(int y = celly-ring; y<=celly+ring; y++) {
+			if((y<0) || (y>=numRows)) continue;
+
+			// only the edges of the ring, the middle has already been checked
+			int xstep = ((y==celly-ring) || (y==celly+ring)) ? 1 : ring*2;
+			if(xstep==0) xstep = 1;
+
+			for(int x = cellx-ring; x<=cellx+ring; x+=xstep) {
+				if((x<0) || (x>=numCols)) continue;
+
+				for(Entry& entry : cells[x+(y*numCols)]) {
+					float distance = position.squareDistance(getEntryPoint(entry));
+
+					if((distance < shortestDistance) ||
+					   ((distance == shortestDistance) &&
+						((entry.index < nearestIndex) || ((entry.index == nearestIndex) && !entry.reversed)))) {
+						shortestDistance = distance;
+						nearestIndex = entry.index;
+						nearestReversed = entry.reversed;
+					}
+				}
+			}
+		}
+
+		// find the closest edge of the area we've searched so far. Anything
+		// we haven't checked yet must be at least this far away.
+		float searchedDistance = INFINITY;
+		bool moreToSearch = false;
+		if(cellx-ring>0) {
+			searchedDistance = MIN(searchedDistance, position.x - (left + ((cellx-ring)*cellSize)));
+			moreToSearch = true;
+		}
+		if(cellx+ring<numCols-1) {
+			searchedDistance = MIN(searchedDistance, (left + ((cellx+ring+1)*cellSize)) - position.x);
+			moreToSearch = true;
+		}
+		if(celly-ring>0) {
+			searchedDistance = MIN(searchedDistance, position.y - (top + ((celly-ring)*cellSize)));
+			moreToSearch = true;
+		}
+		if(celly+ring<numRows-1) {
+			searchedDistance = MIN(searchedDistance, (top + ((celly+ring+1)*cellSize)) - position.y);
+			moreToSearch = true;
+		}
+
+		if(!moreToSearch) break;
+
+		searchedDistance -= margin;
+		if((nearestIndex>=0) && (searchedDistance>0) && (shortestDistance < searchedDistance*searchedDistance)) break;
+	}
+
+	reversed = nearestReversed;
+	return nearestIndex;
+}
+
+void ShapePointsIndex :: addEntry(int index, bool reversed) {
+
+	Entry entry;
+	entry.index = index;
+	entry.reversed = reversed;
+	Point& p = getEntryPoint(entry);
+	cells[getCellX(p.x)+(getCellY(p.y)*numCols)].push_back(entry);
+	numEntries++;
+}
+
+void ShapePointsIndex :: removeEntry(int index, bool reversed) {
+
+	Entry entry;
+	entry.index = index;
+	entry.reversed = reversed;
+	Point& p = getEntryPoint(entry);
+	vector<Entry>& cell = cells[getCellX(p.x)+(getCellY(p.y)*numCols)];
+
+	// order in the cell doesn't matter so swap with the last one
+	for(int i = 0; i<cell.size(); i++) {
+		if((cell[i].index==index) && (cell[i].reversed==reversed)) {
+			cell[i] = cell.back();
+			cell.pop_back();
+			numEntries--;
+			return;
+		}
+	}
+}
+
+int ShapePointsIndex :: getCellX(float x) {
+	return ofClamp(floor((x-left)/cellSize), 0, numCols-1);
+}
+
+int ShapePointsIndex :: getCellY(float y) {
+	return ofClamp(floor((y-top)/cellSize), 0, numRows-1);
+}
+
+Point& ShapePointsIndex :: getEntryPoint(const Entry& entry) {
+	// the index always stores the un-reversed segment, so a reversed
+	// entry starts from the back
+	ShapePoints& segment = (*shapePoints)[entry.index];
+	return entry.reversed ? segment.back() : segment.front();
+}
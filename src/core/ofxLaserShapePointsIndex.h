@@ -0,0 +1,56 @@
+//
+//  ofxLaserShapePointsIndex.h
+//  ofxLaser
+//
+//
+//
+
+#pragma once
+#include "ofxLaserShapePoints.h"
+
+namespace ofxLaser {
+
+	// A uniform grid of all the start and end points of a set of ShapePoints.
+	// Used to find the nearest untested segment when we sort the shapes, so
+	// that we don't have to check every segment against every other segment.
+	// Reversable segments get an entry for each end, non-reversable
+	// segments only have an entry for their start point.
+	class ShapePointsIndex {
+
+		public :
+
+		void build(vector<ShapePoints>& shapepoints);
+
+		// removes both ends of the segment from the grid
+		void remove(int index);
+
+		// returns the index of the nearest segment to position, or -1 if
+		// there aren't any left. Ties are resolved in the same way as the
+		// old linear search - lowest index first, forwards before reversed.
+		int findNearest(const Point& position, bool& reversed);
+
+		protected :
+
+		struct Entry {
+			int index;
+			bool reversed;
+		};
+
+		void addEntry(int index, bool reversed);
+		void removeEntry(int index, bool reversed);
+		int getCellX(float x);
+		int getCellY(float y);
+		Point& getEntryPoint(const Entry& entry);
+
+		vector<ShapePoints>* shapePoints = nullptr;
+		vector<vector<Entry>> cells;
+
+		int numCols = 0;
+		int numRows = 0;
+		float left = 0;
+		float top = 0;
+		float cellSize = 1;
+		int numEntries = 0;
+
+	};
+}
@@ -8,6 +8,8 @@
 
 #pragma once
 #include "ofxLaserPoint.h"
+#include "ofxLaserPointBuffer.h"
+#include <atomic>
 
 namespace ofxLaser {
 
@@ -15,6 +17,18 @@ namespace ofxLaser {
 	public:
 		DacBase() {};
 		
+		// the projector sends PointBuffers. Unless they're overridden they
+		// get turned into vectors of Points and passed on to the versions
+		// below, so DACs that only override those still work. The built in
+		// DACs override these instead so they don't have to convert.
+		virtual bool sendFrame(const PointBuffer& points) {
+			points.copyTo(adapterPoints);
+			return sendFrame(adapterPoints);
+		};
+		virtual bool sendPoints(const PointBuffer& points) {
+			points.copyTo(adapterPoints);
+			return sendPoints(adapterPoints);
+		};
 		virtual bool sendFrame(const vector<Point>& points) { return true; };
 		virtual bool sendPoints(const vector<Point>& points) { return true; };
 		virtual bool setPointsPerSecond(uint32_t pps) { return true; };
@@ -25,20 +39,33 @@ namespace ofxLaser {
 		virtual const vector<ofAbstractParameter*>& getDisplayData() { return displayData;};
 		virtual void resetDisplayData(){};
 		virtual void reset() {};
+		
+		// for pull mode - how long until the DAC runs out of points and
+		// wants the next frame, in microseconds (0 if it wants one now).
+		// Returns -1 if it can't tell, so we just send it a frame every
+		// time like normal.
+		int64_t getMicrosUntilFrameNeeded() {
+			uint64_t needed = frameNeededMicros.load(std::memory_order_relaxed);
+			if(needed==0) return -1;
+			int64_t until = (int64_t)needed - (int64_t)ofGetElapsedTimeMicros();
+			return MAX(until, 0);
+		};
+		// true if the DAC hasn't picked up the last frame we sent yet
+		virtual bool isFrameWaiting() { return false; };
 
 
-		static uint16_t bytesToUInt16(unsigned char* byteaddress) {
+		static uint16_t bytesToUInt16(const unsigned char* byteaddress) {
 			return (uint16_t)(*(byteaddress+1)<<8)|*byteaddress;
 			
 		}
-		static uint16_t bytesToInt16(unsigned char* byteaddress) {
-			uint16_t i = *(signed char *)(byteaddress);
+		static uint16_t bytesToInt16(const unsigned char* byteaddress) {
+			uint16_t i = *(const signed char *)(byteaddress);
 			i *= 1 << CHAR_BIT;
 			i |= (*byteaddress+1);
 			return i;
 			
 		}
-		static uint32_t bytesToUInt32(unsigned char* byteaddress){
+		static uint32_t bytesToUInt32(const unsigned char* byteaddress){
 			return (uint32_t)(*(byteaddress+3)<<24)|(*(byteaddress+2)<<16)|(*(byteaddress+1)<<8)|*byteaddress;
 			
 		}
@@ -63,6 +90,16 @@ namespace ofxLaser {
 	
 		vector<ofAbstractParameter*> displayData;
 		bool resetFlag = false;
+		// for converting between the two kinds of sendFrame / sendPoints
+		PointBuffer adapterBuffer;
+		vector<Point> adapterPoints;
+		
+		// the DAC thread sets this whenever it works out when it's going
+		// to need the next frame, 0 if it doesn't know
+		void setFrameNeededTime(uint64_t micros) {
+			frameNeededMicros.store(micros, std::memory_order_relaxed);
+		};
+		std::atomic<uint64_t> frameNeededMicros{0};
 
 	};
 
@@ -22,22 +22,23 @@ DacEtherdream :: DacEtherdream(){
 	pointBufferDisplay.set("Point Buffer", 0,0,1799);
 	latencyDisplay.set("Latency", 0,0,10000);
 	reconnectCount.set("Reconnect Count", 0, 0,10);
+	bufferTargetDisplay.set("Buffer Target", 0, 0, 1799);
+	connectionStatusDisplay.set("Connection", "");
+	displayData.push_back(&connectionStatusDisplay);
 	displayData.push_back(&pointBufferDisplay);
+	displayData.push_back(&bufferTargetDisplay);
 	displayData.push_back(&latencyDisplay);
 	displayData.push_back(&reconnectCount);
     numPointsToSend = 0;
+	
+	// enough for half a second at 100k pps in point mode, or a
+	// (very) big frame on top of a full DAC buffer in frame mode
+	bufferedPoints.setCapacity(1<<17);
     
-    
-    //TODO
-    // this should really be dependent on network latency	
-    // and also we should have the option of lower latency on better networks
-	// also make this adjustable
-	// also maxBufferedPoints should be higher on etherdream 2
-	//
-    dacBufferSize = 1200; 				// the maximum points to fill the buffer with
-	pointsToSendBeforePlaying = 500;//500;//100; 	// the minimum number of points to buffer before
-										// we tell the ED to start playing
-										// TODO - these should be time based!
+	// starting values until bufferController has measured the network,
+	// after that they're worked out from the target latency
+    dacBufferSize = bufferController.getFillTarget();
+	pointsToSendBeforePlaying = bufferController.getLowWaterMark();
 
 }
 const vector<ofAbstractParameter*>& DacEtherdream :: getDisplayData() {
@@ -45,16 +46,37 @@ const vector<ofAbstractParameter*>& DacEtherdream :: getDisplayData() {
 	
 		//pointBufferDisplay += (response.status.buffer_fullness-pointBufferDisplay)*1;
 		
-		int pointssincelastmessage = (float)((ofGetElapsedTimeMicros()-lastMessageTimeMicros)*response.status.point_rate)/1000000.0f;
+		int pointssincelastmessage = (float)((ofGetElapsedTimeMicros()-displayStatus.lastMessageTimeMicros)*displayStatus.pointRate)/1000000.0f;
 		
-		pointBufferDisplay = response.status.buffer_fullness-pointssincelastmessage;
+		pointBufferDisplay = MAX(displayStatus.bufferFullness-pointssincelastmessage, 0);
 																 
-		latencyDisplay += (latencyMicros - latencyDisplay)*0.1;
-		reconnectCount = prepareSendCount;
+		latencyDisplay += (displayStatus.latencyMicros - latencyDisplay)*0.1;
+		pointBufferDisplay.setMax(displayStatus.capacity);
+		bufferTargetDisplay.setMax(displayStatus.capacity);
+		bufferTargetDisplay = displayStatus.bufferTarget;
+		reconnectCount = displayStatus.prepareSendCount;
 	
 		unlock();
 	}
 	
+	// the connection info is all atomic so we don't need the lock
+	switch(connectionState) {
+		case ETHERDREAM_CONNECTING :
+			connectionStatusDisplay = "Connecting (attempt "+ofToString(connectAttempts)+")";
+			break;
+		case ETHERDREAM_BACKOFF : {
+			int64_t wait = (int64_t)nextConnectTimeMicros - (int64_t)ofGetElapsedTimeMicros();
+			connectionStatusDisplay = "Retry in "+ofToString(MAX(wait,0)/1000)+"ms (attempt "+ofToString(connectAttempts)+")";
+			break;
+		}
+		case ETHERDREAM_CONNECTED :
+			connectionStatusDisplay = "Connected in "+ofToString(connectTimeMillis)+"ms";
+			break;
+		case ETHERDREAM_PLAYING :
+			connectionStatusDisplay = "Playing, connected in "+ofToString(connectTimeMillis)+"ms";
+			break;
+	}
+	
 	return displayData;
 }
 
@@ -62,17 +84,6 @@ DacEtherdream :: ~DacEtherdream(){
 	
 	close();
 	
-	for (int i = 0; i < sparePoints.size(); ++i) {
-		delete sparePoints[i]; // Calls ~object (which deallocates tmp[i]->foo)
-		// and deallocates *tmp[i]
-	}
-	sparePoints.clear();
-	for (int i = 0; i < bufferedPoints.size(); ++i) {
-		delete bufferedPoints[i]; // Calls ~object (which deallocates tmp[i]->foo)
-		// and deallocates *tmp[i]
-	}
-	bufferedPoints.clear();
-	
 }
 
 void DacEtherdream :: close() {
@@ -80,75 +91,128 @@ void DacEtherdream :: close() {
 	
 	if(isThreadRunning()) waitForThread();
 	if(connected) {
+		// the thread's stopped so this has to wait for the ack regardless
 		sendStop();
-		waitForAck('s');
+		waitForAck('s', false);
 		socket.close();
+		connected = false;
 	}
 }
-void DacEtherdream :: setup(string ip) {
-	// TODO - this can return a Poco::Net::HostNotFoundException - add try / catch
+void DacEtherdream :: setup(string ip, int port) {
 
-	
 	pps = 0;
 	pps = newPPS = 30000; // this is always sent on begin
 	queuedPPSChangeMessages = 0;
 	connected = false;
 	ipaddress = ip;
+	this->port = port;
+	
+	// all the connecting happens in the thread, so this never holds up
+	// the app, even if the etherdream isn't there
+	connectAttempts = 0;
+	backoffMillis = minBackoffMillis;
+	nextConnectTimeMicros = 0;
+	connectionState = ETHERDREAM_CONNECTING;
+	beginSent = false;
+	startThread(); // blocking is true by default I think?
+	
+	auto & thread = getNativeThread();
+	
+#ifndef _MSC_VER
+	// only linux and osx
+	//http://www.yonch.com/tech/82-linux-thread-priority
+	struct sched_param param;
+	param.sched_priority = 60; // 89;
+	pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param );
+#else
+	// windows implementation
+	SetThreadPriority( thread.native_handle(), THREAD_PRIORITY_HIGHEST);
+#endif
+	
+}
+
+bool DacEtherdream :: connectToDac() {
+	
+	uint64_t starttime = ofGetElapsedTimeMicros();
+	connectAttempts++;
+	connected = false;
 	
 	Poco::Timespan timeout(1 * 250000); // 1/4 seconds timeout
 	
 	try {
-		// Etherdreams always talk on port 7765
-		Poco::Net::SocketAddress sa(ip, 7765);
-		//ofLog(OF_LOG_NOTICE, "TIMEOUT" + ofToString(timeout.totalSeconds()));
-		socket.connect(sa, timeout);
+		// a new socket every time, you can't reuse one that's failed
+		socket = Poco::Net::StreamSocket();
+		// Etherdreams always talk on port 7765 (unless it's an emulator)
+		Poco::Net::SocketAddress sa(ipaddress, port);
+		socket.connectNB(sa);
+		
+		// wait for it to connect a bit at a time, so that we can still
+		// stop the thread if we need to
+		bool ready = false;
+		while(!ready) {
+			if(!isThreadRunning()) return false;
+			if(ofGetElapsedTimeMicros()-starttime > connectTimeoutMillis*1000) {
+				throw Poco::TimeoutException();
+			}
+			ready = socket.poll(Poco::Timespan(10000), Poco::Net::Socket::SELECT_WRITE | Poco::Net::Socket::SELECT_ERROR);
+		}
+		int error = socket.impl()->socketError();
+		if(error!=0) throw Poco::Net::NetException("connection refused", error);
+		
+		// everything else is simpler with a blocking socket
+		socket.setBlocking(true);
 		socket.setSendTimeout(timeout);
 		socket.setReceiveTimeout(timeout);
 		
 		connected = true;
-	} catch (Poco::Exception& exc) {
-		//Handle your network errors.
-		ofLog(OF_LOG_ERROR,  "DacEtherdream setup failed - Network error: " +ip+" "+ exc.displayText());
-		connected = false;
-
-	}catch (Poco::Net::HostNotFoundException& exc) {
+	} catch (Poco::Net::HostNotFoundException& exc) {
 		//Handle your network errors.
-		ofLog(OF_LOG_ERROR,  "DacEtherdream setup failed - host not found: " + exc.displayText());
-		connected = false;
+		ofLog(OF_LOG_ERROR,  "DacEtherdream connect failed - host not found: " + exc.displayText());
 		
-	}catch (Poco::TimeoutException& exc) {
+	} catch (Poco::TimeoutException& exc) {
 		//Handle your network errors.
-		ofLog(OF_LOG_ERROR,  "DacEtherdream setup failed - Timeout error: " + exc.displayText());
-		connected = false;
+		ofLog(OF_LOG_ERROR,  "DacEtherdream connect failed - Timeout error: " +ipaddress);
 		
+	} catch (Poco::Exception& exc) {
+		//Handle your network errors.
+		ofLog(OF_LOG_ERROR,  "DacEtherdream connect failed - Network error: " +ipaddress+" "+ exc.displayText());
+
+	} catch(...){
+		ofLog(OF_LOG_ERROR, "DacEtherdream connect failed - unknown error");
 	}
-	catch(...){
-		ofLog(OF_LOG_ERROR, "DacEtherdream setup failed - unknown error");
-		//std::rethrow_exception(current_exception);
-		connected = false;
+	
+	if(connected) {
+		connectTimeMillis = (ofGetElapsedTimeMicros()-starttime)/1000;
+		ofLog(OF_LOG_NOTICE, "DacEtherdream connected to "+ipaddress+" in "+ofToString(connectTimeMillis)+"ms");
 	}
-		
+	return connected;
+}
 
-	if(connected) {
-		//prepareSent = false;
-		beginSent = false;
-		startThread(); // blocking is true by default I think?
-		
-		auto & thread = getNativeThread();
-		
-#ifndef _MSC_VER
-		// only linux and osx
-		//http://www.yonch.com/tech/82-linux-thread-priority
-		struct sched_param param;
-		param.sched_priority = 60; // 89;
-		pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param );
-#else
-		// windows implementation
-		SetThreadPriority( thread.native_handle(), THREAD_PRIORITY_HIGHEST);
-#endif
+void DacEtherdream :: disconnect() {
 	
-
+	try {
+		socket.close();
+	} catch(...) {
+		// doesn't matter
 	}
+	connected = false;
+	beginSent = false;
+	clearCommandsInFlight();
+	// forget what the DAC last told us, it'll tell us again when we reconnect
+	response.status.playback_state = PLAYBACK_IDLE;
+	response.status.buffer_fullness = 0;
+	setFrameNeededTime(0);
+	
+}
+
+void DacEtherdream :: startBackoff() {
+	
+	// wait twice as long every time it fails, up to maxBackoffMillis
+	nextConnectTimeMicros = ofGetElapsedTimeMicros() + (uint64_t)backoffMillis*1000;
+	ofLog(OF_LOG_NOTICE, "DacEtherdream "+ipaddress+" - trying again in "+ofToString(backoffMillis)+"ms");
+	backoffMillis = MIN(backoffMillis*2, maxBackoffMillis);
+	connectionState = ETHERDREAM_BACKOFF;
+	
 }
 
 void DacEtherdream :: reset() {
@@ -175,46 +239,33 @@ void DacEtherdream :: closeWhileRunning() {
 
 
 
-bool DacEtherdream:: sendFrame(const vector<Point>& points){
+bool DacEtherdream:: sendFrame(const PointBuffer& points){
 
-//	ofLog(OF_LOG_NOTICE, "point create count  : " + ofToString(dac_point::createCount));
-//	ofLog(OF_LOG_NOTICE, "point destroy count : " + ofToString(dac_point::destroyCount));
-	//int maxBufferSize = 1000;
-	dac_point& p1 = sendpoint;
-	
-	// if we already have too many points in the buffer,
-	// then it means that we need to skip this frame
+	// the frame is converted straight into the spare buffer without
+	// locking anything, so the DAC thread never has to wait for us.
+	// If it hasn't picked up the last frame yet, that one gets replaced.
+	vector<dac_point>& frame = frameBuffers.getWriteBuffer();
+	frame.resize(points.size());
 	
-	//if(isReplaying || (bufferedPoints.size()<pointsToSendBeforePlaying)) {
-
+	dac_point p1;
+	for(int i = 0; i<points.size(); i++) {
+		
+		p1.control = 0;
+		p1.x = ofMap(points.x[i],0,800,ETHERDREAM_MIN, ETHERDREAM_MAX);
+		p1.y = ofMap(points.y[i],800,0,ETHERDREAM_MIN, ETHERDREAM_MAX); // Y is UP
+		p1.r = points.r[i]/255.0f*65535;
+		p1.g = points.g[i]/255.0f*65535;
+		p1.b = points.b[i]/255.0f*65535;
+		p1.i = 0;
+		p1.u1 = 0;
+		p1.u2 = 0;
+		
+		frame[i] = p1;
+	}
 	
-		if(lock()) {
-			frameMode = true;
-			framePoints.resize(points.size());
-
-			for(int i = 0; i<points.size(); i++) {
-				
-				const Point& p2 = points[i];
-				p1.x = ofMap(p2.x,0,800,ETHERDREAM_MIN, ETHERDREAM_MAX);
-				p1.y = ofMap(p2.y,800,0,ETHERDREAM_MIN, ETHERDREAM_MAX); // Y is UP
-				p1.r = p2.r/255.0f*65535;
-				p1.g = p2.g/255.0f*65535;
-				p1.b = p2.b/255.0f*65535;
-				p1.i = 0;
-				p1.u1 = 0;
-				p1.u2 = 0;
-				//addPoint(p1);
-				
-				framePoints[i] = p1;
-			}
-			newFrame = true;
-			unlock();
-		}
-		return true;
-	//} else {
-		// we've skipped this frame... TODO - dropped frame count?
-	//	return false;
-	//}
+	frameMode = true;
+	frameBuffers.publish();
+	return true;
 }
 
 
@@ -237,131 +288,237 @@ inline bool DacEtherdream :: sendData(){
 	
 	// TODO make these params
 	//float minBufferTime = 0.01; // (30 frames at 30k)
-	int minBuffer = pointsToSendBeforePlaying; // pps*minBufferTime;
+	// resend the last frame if the buffer's getting so low that the
+	// next lot of points might not get there in time
+	int minBuffer = bufferController.getMinimumLevel(); // pps*minBufferTime;
 	
 	// system for resending existing frames... probably can be optimised
 	// if we're in frame mode and we're replaying frames
 	if(frameMode) {
 		
-		// send as many points as we can,
-		npointstosend = MIN(bufferedPoints.size(), numPointsToSend);
+		// the frame points are shared with the app thread
+		while(!lock()) {}
 		
-		// now calculate the min points before we send the new frame...
-		// if we have a new frame, then send it as long as we have spare points
-		int minpointcount;
-		if(newFrame) {
-			minpointcount = numPointsToSend;
-		} else { // otherwise just send it if we're at the absolute minimum
-			minpointcount = MAX(minBuffer - response.status.buffer_fullness,0);
-		}
+		// sendPoints might have switched frame mode off while we were waiting
+		if(frameMode) {
+			
+			// pick up the latest frame from the app thread if there is one
+			if(frameBuffers.update()) newFrame = true;
+			vector<dac_point>& framePoints = frameBuffers.getReadBuffer();
+			
+			// send as many points as we can,
+			npointstosend = MIN(bufferedPoints.getAvailable(), numPointsToSend);
 		
-		while((framePoints.size()>0) && (npointstosend<minpointcount)) {
-			//cout << npointstosend << " " << minpointcount << endl;
-			// send the frame!
-			for(int i = 0; i<framePoints.size(); i++) {
-				addPoint(framePoints[i]);
+			// now calculate the min points before we send the new frame...
+			// if we have a new frame, then send it as long as we have spare points
+			int minpointcount;
+			if(newFrame) {
+				minpointcount = numPointsToSend;
+			} else { // otherwise just send it if we're at the absolute minimum
+				minpointcount = MAX(minBuffer - estimatedBufferFullness,0);
 			}
-			newFrame = false;
-			npointstosend = MIN(bufferedPoints.size(), numPointsToSend);
 		
-		}
+			while((framePoints.size()>0) && (npointstosend<minpointcount)) {
+				//cout << npointstosend << " " << minpointcount << endl;
+				// send the frame!
+				if(bufferedPoints.push(framePoints.data(), framePoints.size())<framePoints.size()) {
+					ofLog(OF_LOG_WARNING, "ofxLaser::DacEtherdream - frame too big for the point buffer, some points were lost");
+				}
+				newFrame = false;
+				npointstosend = MIN(bufferedPoints.getAvailable(), numPointsToSend);
 		
+			}
+			
+			// it'll replay the frame when the points run down to minBuffer,
+			// so that's when it'll want the next one
+			if(pps>0) {
+				int pointsleft = estimatedBufferFullness + (int)bufferedPoints.getAvailable() - minBuffer;
+				setFrameNeededTime(ofGetElapsedTimeMicros() + (uint64_t)MAX(pointsleft, 0)*1000000ull/pps);
+			}
+		}
+		unlock();
 		
 	}
-		outbuffer[0]= command;
+	// nothing to send yet, the frame hasn't arrived
+	if(npointstosend==0) return false;
+	
+	outbuffer[0]= command;
 	writeUInt16ToBytes(npointstosend, &outbuffer[1]);
-	int pos = 3;
 	
-	dac_point& p = sendpoint;
+	// the points are sent straight out of the ring buffer, which might
+	// mean two blocks if they wrap around the end of it
+	dac_point* blocks[3];
+	int blocksizes[3];
+	size_t first, second;
+	int numbuffered = bufferedPoints.peek(npointstosend, blocks[0], first, blocks[1], second);
+	blocksizes[0] = first;
+	blocksizes[1] = second;
 	
-	for(int i = 0; i<npointstosend; i++) {
-		
-		if(bufferedPoints.size()>0) {
-			p = *bufferedPoints[0]; // copy assignment
-			sparePoints.push_back(bufferedPoints[0]); // recycling system
-			bufferedPoints.pop_front(); // no longer destroys point
-			lastpoint = p; //
-		} else  {
-			// just send some blank points in the same position as the
-			// last point
-			// TODO count the blanks!
-			
-			p = lastpoint;
-			
-			p.i = 0;
-			p.r = 0;
-			p.g = 0;
-			p.b = 0;
-			p.u1 = 0;
-			p.u2 = 0;
-		}
-		
-		if(queuedPPSChangeMessages>0) {
-			// bit 15 is a flag to tell the DAC about a new point rate
-			p.control = 0b1000000000000000;
+	if(numbuffered>0) {
+		lastpoint = (second>0) ? blocks[1][second-1] : blocks[0][first-1];
+	}
+	
+	// if we don't have enough then pad it out with blank points
+	// in the same position as the last point
+	// TODO count the blanks!
+	dac_point blank = lastpoint;
+	blank.control = 0;
+	blank.i = 0;
+	blank.r = 0;
+	blank.g = 0;
+	blank.b = 0;
+	blank.u1 = 0;
+	blank.u2 = 0;
+	blankPoints.assign(npointstosend-numbuffered, blank);
+	blocks[2] = blankPoints.data();
+	blocksizes[2] = blankPoints.size();
+	
+	// the only thing that changes once the points are in the buffer is
+	// the control word - bit 15 tells the DAC about a new point rate.
+	// All the points are ours until we discard them, so we can just
+	// change them where they are.
+	for(int block = 0; (block<3) && (queuedPPSChangeMessages>0); block++) {
+		for(int i = 0; (i<blocksizes[block]) && (queuedPPSChangeMessages>0); i++) {
+			blocks[block][i].control = 0b1000000000000000;
 			queuedPPSChangeMessages--;
 		}
-		
-		writeUInt16ToBytes(p.control, &outbuffer[pos]);
-		pos+=2;
-		writeInt16ToBytes(p.x, &outbuffer[pos]);
-		pos+=2;
-		writeInt16ToBytes(p.y, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.r, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.g, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.b, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.i, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.u1, &outbuffer[pos]);
-		pos+=2;
-		writeUInt16ToBytes(p.u2, &outbuffer[pos]);
-		pos+=2;
-		
 	}
 	
-	numBytesSent = pos;
-	if(numBytesSent>=100000) {
-		
-		ofLog(OF_LOG_ERROR, "ofxLaser::DacEtherdream - too many bytes to send! - " + ofToString(numBytesSent));
+	for(int block = 0; block<3; block++) {
+		pointsToWireFormat(blocks[block], blocksizes[block]);
+	}
+	
+	if(verbose) {
+		loggedPoints.clear();
+		for(int block = 0; block<3; block++) {
+			loggedPoints.insert(loggedPoints.end(), blocks[block], blocks[block]+blocksizes[block]);
+		}
 	}
-	return sendBytes(&outbuffer, numBytesSent);
+	
+	bool success = sendBytes(outbuffer, 3, (const dac_point**)blocks, blocksizes, 3);
+	
+	// whether it worked or not, these points are done with
+	bufferedPoints.discard(numbuffered);
+	
+	return success;
 	//cout << "sent " << n << " bytes" << endl;
 	//cout << "numPointsToSend " << numPointsToSend << endl;
 }
 
+int DacEtherdream :: sendGathered(const void* header, int headerlength, const dac_point** points, const int* numpoints, int numblocks) {
+	
+	// Poco doesn't do scatter / gather sends so we go straight to the
+	// socket. This gets the kernel to join up the header and the blocks
+	// of points so we don't have to copy them into one buffer.
+	const int maxblocks = 4;
+	int numbuffers = 0;
+	int total = 0;
+	
+#ifdef TARGET_WIN32
+	WSABUF buffers[maxblocks];
+	buffers[numbuffers].buf = (CHAR*)header;
+	buffers[numbuffers].len = headerlength;
+	numbuffers++;
+	for(int i = 0; (i<numblocks) && (numbuffers<maxblocks); i++) {
+		if(numpoints[i]==0) continue;
+		buffers[numbuffers].buf = (CHAR*)points[i];
+		buffers[numbuffers].len = numpoints[i]*sizeof(dac_point);
+		numbuffers++;
+	}
+	
+	DWORD sent = 0;
+	// a blocking socket doesn't return until it's all gone (or it
+	// timed out). If it timed out we don't know how much of it went,
+	// so we return what we do know and sendBytes treats it as short.
+	if(WSASend(socket.impl()->sockfd(), buffers, numbuffers, &sent, 0, NULL, NULL)!=0) {
+		int error = WSAGetLastError();
+		if(error!=WSAETIMEDOUT) throw Poco::Net::NetException("WSASend failed", error);
+	}
+	total = sent;
+#else
+	struct iovec buffers[maxblocks];
+	buffers[numbuffers].iov_base = (void*)header;
+	buffers[numbuffers].iov_len = headerlength;
+	numbuffers++;
+	for(int i = 0; (i<numblocks) && (numbuffers<maxblocks); i++) {
+		if(numpoints[i]==0) continue;
+		buffers[numbuffers].iov_base = (void*)points[i];
+		buffers[numbuffers].iov_len = numpoints[i]*sizeof(dac_point);
+		numbuffers++;
+	}
+	
+	// writev can send less than we asked for, in which case
+	// we carry on from wherever it got to. If it times out, we
+	// return however much went and sendBytes treats it as short.
+	struct iovec* next = buffers;
+	while(numbuffers>0) {
+		ssize_t sent = writev(socket.impl()->sockfd(), next, numbuffers);
+		if(sent<0) {
+			if(errno==EINTR) continue;
+			if((errno==EAGAIN) || (errno==EWOULDBLOCK)) break;
+			throw Poco::Net::NetException("writev failed", errno);
+		}
+		total+=sent;
+		while((numbuffers>0) && (sent>=(ssize_t)next->iov_len)) {
+			sent-=next->iov_len;
+			next++;
+			numbuffers--;
+		}
+		if(numbuffers>0) {
+			next->iov_base = (uint8_t*)next->iov_base+sent;
+			next->iov_len-=sent;
+		}
+	}
+#endif
+	return total;
+}
+
+void DacEtherdream :: pointsToWireFormat(dac_point* points, int count) {
+#ifdef ETHERDREAM_BIG_ENDIAN_HOST
+	// every value in the point is 16 bits so we can just swap each pair of bytes
+	for(int i = 0; i<count; i++) {
+		uint16_t* values = (uint16_t*)&points[i];
+		for(int j = 0; j<9; j++) {
+			values[j] = (uint16_t)((values[j]>>8) | (values[j]<<8));
+		}
+	}
+#endif
+}
+
 
 
-bool DacEtherdream:: sendPoints(const vector<Point>& points){
+bool DacEtherdream:: sendPoints(const PointBuffer& points){
     // max half second buffer
 	//cout << "DacEtherdream::sendPoints -------------------------" << endl;
     if(bufferedPoints.size()>pps*0.5) {
         return false;
     }
 	
-	
+	// no need to lock for the points, we're the only thread adding to
+	// the buffer when we're not in frame mode
     dac_point p1;
-	if(lock()) {
+	if(frameMode) {
+		// the DAC thread only adds frames while it has the lock, so once
+		// we've switched it off in here it'll never add another one
+		while(!lock()) {}
 		frameMode = false;
+		setFrameNeededTime(0);
+		unlock();
+	}
+	
+	for(int i = 0; i<points.size(); i++) {
 		
-		for(int i = 0; i<points.size(); i++) {
-			
-			const Point& p2 = points[i];
-			p1.x = ofMap(p2.x,0,800,ETHERDREAM_MIN, ETHERDREAM_MAX);
-			p1.y = ofMap(p2.y,800,0,ETHERDREAM_MIN, ETHERDREAM_MAX); // Y is UP in ilda specs
-			p1.r = p2.r/255.0f*65535;
-			p1.g = p2.g/255.0f*65535;
-			p1.b = p2.b/255.0f*65535;
-			p1.i = 0;
-			p1.u1 = 0;
-			p1.u2 = 0;
-			addPoint(p1);
+		p1.control = 0;
+		p1.x = ofMap(points.x[i],0,800,ETHERDREAM_MIN, ETHERDREAM_MAX);
+		p1.y = ofMap(points.y[i],800,0,ETHERDREAM_MIN, ETHERDREAM_MAX); // Y is UP in ilda specs
+		p1.r = points.r[i]/255.0f*65535;
+		p1.g = points.g[i]/255.0f*65535;
+		p1.b = points.b[i]/255.0f*65535;
+		p1.i = 0;
+		p1.u1 = 0;
+		p1.u2 = 0;
+		addPoint(p1);
 
-		}
-		unlock();
 	}
 	return true;
   
@@ -381,22 +538,48 @@ inline bool DacEtherdream :: addPoint(const dac_point &point ){
 		//}
 	//}
 	
-	dac_point* p = getDacPoint();
-	*p = point; // copy assignment hopefully!
-	bufferedPoints.push_back(p);
-	return true;
+	return bufferedPoints.push(point);
 }
 
 
 void DacEtherdream :: threadedFunction(){
 	
-	waitForAck('?');
-	
 	bool needToSendPrepare = true;
 	//bool needToSendBegin = true;
 	
 	while(isThreadRunning()) {
 		
+		if(connectionState==ETHERDREAM_BACKOFF) {
+			if(ofGetElapsedTimeMicros()<nextConnectTimeMicros) {
+				sleep(5);
+				continue;
+			}
+			connectionState = ETHERDREAM_CONNECTING;
+		}
+		
+		if(connectionState==ETHERDREAM_CONNECTING) {
+			
+			if(connectToDac()) {
+				// the etherdream sends us its status as soon as we connect
+				clearCommandsInFlight();
+				EtherdreamCommand hello;
+				hello.command = '?';
+				hello.numPoints = 0;
+				hello.sentMicros = ofGetElapsedTimeMicros();
+				hello.queued = false;
+				commandsInFlight.push_back(hello);
+				waitForAck('?');
+				needToSendPrepare = true;
+			}
+			if(connected) {
+				connectionState = ETHERDREAM_CONNECTED;
+			} else {
+				disconnect();
+				if(isThreadRunning()) startBackoff();
+			}
+			continue;
+		}
+		
 		
 		// flag 010 is an underflow check. So if it didn't
 		// get enough points when it needed them, we have to restart
@@ -414,26 +597,42 @@ void DacEtherdream :: threadedFunction(){
 			
 			resetFlag = false;
 			
-			// clear the socket of data
-			try {
-				int n = socket.receiveBytes(buffer, 1000);
-			} catch(...) {
-				// doesn't matter
+			// read the answers to everything that's still in flight, so the
+			// next response we read is the one for the ping. Just reading
+			// whatever's in the socket could stop part way through a
+			// response and then we'd be out of step for ever more, so if
+			// we can't get them all, start again with a new connection.
+			bool insync = true;
+			while(commandsInFlight.size()>0) {
+				if(!isThreadRunning() || !receiveResponses(true)) {
+					insync = false;
+					break;
+				}
+			}
+			if(insync) {
+				clearCommandsInFlight();
+				insync = sendPing() && waitForAck('?');
 			}
-			sendPing();
-			waitForAck('?');
-			if(response.status.light_engine_state == LIGHT_ENGINE_ESTOP) {
-				sendClear();
-				waitForAck('c');
+			if(insync && (response.status.light_engine_state == LIGHT_ENGINE_ESTOP)) {
+				insync = sendClear() && waitForAck('c');
+			}
+			if(!insync) {
+				disconnect();
+				if(isThreadRunning()) startBackoff();
+				continue;
 			}
 			prepareSendCount = 0;
 			
 			// clear frame
-			for(dac_point* point : bufferedPoints) {
-				*point = framePoints[0];
-				point->r = 0;
-				point->g = 0;
-				point->b = 0;
+			vector<dac_point>& framePoints = frameBuffers.getReadBuffer();
+			if(framePoints.size()>0) {
+				dac_point blank = framePoints[0];
+				blank.r = 0;
+				blank.g = 0;
+				blank.b = 0;
+				bufferedPoints.forEachQueued([&](dac_point& point) {
+					point = blank;
+				});
 			}
 			
 		}
@@ -442,7 +641,7 @@ void DacEtherdream :: threadedFunction(){
 			needToSendPrepare = true;
 		}
 		
-		if(needToSendPrepare) {
+		if(connected && needToSendPrepare) {
 			;
 			bool success = (sendPrepare()	&& waitForAck('p'));
 			
@@ -457,7 +656,7 @@ void DacEtherdream :: threadedFunction(){
 		if(connected && (response.status.playback_state==PLAYBACK_PLAYING) && (newPPS!=pps)) {
 			
 			
-			if(sendPointRate(pps)){
+			if(sendPointRate(newPPS)){
 				pps = newPPS;
 				waitForAck('q');
 				queuedPPSChangeMessages++;
@@ -469,18 +668,36 @@ void DacEtherdream :: threadedFunction(){
 		// if state is prepared or playing, and we have points in the buffer, then send the points
 		if(connected && (response.status.playback_state!=PLAYBACK_IDLE)) {
 			
-			// min buffer amount
-			if(numPointsToSend>pointsToSendBeforePlaying){
-				//check buffer and send the next points
-				while(!lock()) {}
-				sendData();
-				unlock();
-				waitForAck('d');
-			} else if(isThreadRunning()) {
-				// if we're not sending data, then let's ping the etherdream so it can
-				// tell us how many points can fit into its buffer.
+			// deal with any responses that have come in, without waiting
+			receiveResponses(false);
+			
+			// we don't wait for each response before sending the next
+			// command, so work out how full the buffer is from the last
+			// response, how long it's been playing since, and what we've
+			// sent that it hasn't answered yet.
+			estimatedBufferFullness = estimateBufferFullness();
+			numPointsToSend = MAX(dacBufferSize - estimatedBufferFullness, 0);
+			
+			if(!connected) {
+				// receiveResponses failed
+			} else if((commandsInFlight.size()<maxCommandsInFlight) && (numPointsToSend>pointsToSendBeforePlaying)){
+				//check buffer and send the next points. If there aren't
+				//any yet, wait a bit rather than spinning. (If the send
+				//failed it's dropped the connection, that's dealt with below.)
+				if(!sendData() && connected) waitForResponses(1000);
+			} else if((commandsInFlight.size()==0) && (ofGetElapsedTimeMicros()-lastMessageTimeMicros>pingIntervalMicros)) {
+				// we haven't heard from the etherdream for a while, so ping
+				// it to make sure our estimate hasn't drifted
 				sendPing(); // ping is '?' character
-				waitForAck('?');
+			} else {
+				// nothing to do until there's room in the buffer or we hear
+				// back. There's no point asking the DAC, the estimate tells
+				// us how long it'll be before there's room.
+				int waitmicros = 1000;
+				if(response.status.point_rate>0) {
+					waitmicros = ((pointsToSendBeforePlaying-numPointsToSend+1)*1000000LL)/response.status.point_rate;
+				}
+				waitForResponses(waitmicros);
 			}
 			
 		}
@@ -494,11 +711,18 @@ void DacEtherdream :: threadedFunction(){
 		
 		
 		if(!connected) {
-			if(socket.available()) {
-				connected = true;
-				resetFlag = true;
-			}
-			
+			// something went wrong with the network, start again
+			disconnect();
+			if(isThreadRunning()) startBackoff();
+			continue;
+		}
+		
+		if(response.status.playback_state==PLAYBACK_PLAYING) {
+			connectionState = ETHERDREAM_PLAYING;
+			// it's working, so next time it drops out try again straight away
+			backoffMillis = minBackoffMillis;
+		} else {
+			connectionState = ETHERDREAM_CONNECTED;
 		}
 		
 		yield();
@@ -525,136 +749,177 @@ bool DacEtherdream::setPointsPerSecond(uint32_t newpps){
 }
 
 
-inline bool DacEtherdream::waitForAck(char command) {
-	
-	// TODO :
+inline bool DacEtherdream::waitForAck(char command, bool stopwiththread) {
 	
-	// ADD TIMEOUT!
-	
-	// keep parsing buffer data
-	// check validity of response
-	// if response not valid then clear buffer and send ping?
+	// the DAC answers everything in order, so once there's nothing
+	// left in flight we've had the response to this command too
+	while(commandsInFlight.size()>0) {
+		if(stopwiththread && !isThreadRunning()) return false;
+		if(!receiveResponses(true)) return false;
+	}
+	if(response.command!=command) {
+		ofLog(OF_LOG_WARNING, "DacEtherdream::waitForAck - expected response to "+ofToString(command)+" but got "+ofToString(response.command));
+	}
+	return response.response!='I';
+}
+
+bool DacEtherdream :: receiveResponses(bool wait) {
 	
-	// basically this just waits til there's stuff in the socket
-	// to read. Bit of code gymnastics because I was getting
-	// an error when closing the socket.
+	if(!wait) {
+		try {
+			// if there's nothing to read but the socket says it's
+			// readable then the other end has closed it, so carry on
+			// and let receiveBytes tell us
+			if((socket.available()<=0) && !socket.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ)) return true;
+		} catch(...) {
+			// so will this
+		}
+	}
 	
-	bool waiting = true;
 	bool failed = false;
-//	int count = 0;
-//	int timeoutwait = 1000;// one second - ish
-//	while(waiting && !failed) {
-//
-//
-//		if(lock()) {
-//            if(socket.available()){
-//				waiting = false;
-//            }
-//			unlock();
-//		}
-//
-//		if(!isThreadRunning()) return false;
-//
-//        if(waiting) {
-//            yield();
-//            sleep(1);
-//			//count++;
-//        }
-//
-////		if(count > timeoutwait) {
-////			failed = true;
-////			ofLog(OF_LOG_WARNING, "DACEtherdream.waitForAck timeout)" );
-////
-////		}
-//	}
+	int n = 0;
+	try {
+		// read whatever's there, it could be part of a response or
+		// several of them together
+		n = socket.receiveBytes(responseBuffer+responseBufferSize, sizeof(responseBuffer)-responseBufferSize);
+	} catch (Poco::TimeoutException& exc) {
+		//Handle your network errors.
+		ofLog(OF_LOG_ERROR,  "Timeout error: " + exc.displayText());
+		failed = true;
+	} catch (Poco::Exception& exc) {
+		//Handle your network errors.
+		ofLog(OF_LOG_ERROR,  "Network error: " + exc.displayText());
+		failed = true;
+	}
 	
+	// this should mean that the socket has been closed...
+	if(n<=0) failed = true;
 	
-	int n = 0;
-    while ((n==0) && (!failed)) {
-		if(!isThreadRunning()) return false;
-		// i think this should block until it gets bytes
+	if(!failed) {
+		responseBufferSize+=n;
 		
-		try {
-			n = socket.receiveBytes(buffer, 22);
-			lastMessageTimeMicros = ofGetElapsedTimeMicros();
-			latencyMicros = lastMessageTimeMicros - startTime;
-		} catch (Poco::Exception& exc) {
-			//Handle your network errors.
-			ofLog(OF_LOG_ERROR,  "Network error: " + exc.displayText());
-			//	isOpen = false;
-			failed = true;
-		} catch (Poco::TimeoutException& exc) {
-			//Handle your network errors.
-			ofLog(OF_LOG_ERROR,  "Timeout error: " + exc.displayText());
-			//	isOpen = false;
-			failed = true;
-			
+		int pos = 0;
+		while((responseBufferSize-pos>=22) && !failed) {
+			// a NAK is the DAC's problem, not the network's, so the
+			// thread deals with it rather than us dropping the connection
+			processResponse(&responseBuffer[pos]);
+			pos+=22;
 		}
-		
-		// this should mean that the socket has been closed...
-        if((n==0) || (failed)) {
-            //yield();
-		    //sleep(1);
-			//ofLog(OF_LOG_ERROR,  "Socket disconnected");
-			failed = true;
-			
-		}
-		//count ++;
+		// keep any partial response for next time
+		responseBufferSize-=pos;
+		if(responseBufferSize>0) memmove(responseBuffer, &responseBuffer[pos], responseBufferSize);
+	}
 	
-		//if(count > timeoutwait) {
-		//	failed = true;
-		//	ofLog(OF_LOG_WARNING, "DACEtherdream.waitForAck timeout)" );
-			
-		//}
+	if(failed) {
+		beginSent = false;
+		connected = false;
+		clearCommandsInFlight();
+		return false;
+	}
+	return true;
+}
+
+void DacEtherdream :: waitForResponses(int micros) {
+	// poll only works in whole milliseconds, anything less and it
+	// doesn't wait at all, and this thread's priority is high enough
+	// that spinning would starve everything else
+	micros = ofClamp(micros, 1000, 5000);
+	try {
+		socket.poll(Poco::Timespan(micros), Poco::Net::Socket::SELECT_READ);
+	} catch(...) {
+		connected = false;
 	}
-	// = count;
-	// TODO - handle incomplete data
+}
+
+void DacEtherdream :: clearCommandsInFlight() {
+	commandsInFlight.clear();
+	responseBufferSize = 0;
+}
+
+int DacEtherdream :: estimateBufferFullness() {
 	
-	//cout << "received " << n << "bytes" <<endl;
+	// how full it was when it last told us
+	int fullness = response.status.buffer_fullness;
+	// minus what it's played since then. The response took about half
+	// the round trip to get here, so it's older than it looks.
+	if(response.status.playback_state==PLAYBACK_PLAYING) {
+		uint64_t age = ofGetElapsedTimeMicros()-lastMessageTimeMicros + bufferController.getRoundTripMillis()*500;
+		fullness -= (age*response.status.point_rate)/1000000;
+		if(fullness<0) fullness = 0;
+	}
+	// plus everything that's on its way
+	for(EtherdreamCommand& command : commandsInFlight) {
+		fullness+=command.numPoints;
+	}
+	return fullness;
+}
+
+bool DacEtherdream :: processResponse(const uint8_t* data) {
 	
-	if(n==22) {
-		
-		connected = true;
-		response.response = buffer[0];
-		response.command = buffer[1];
-		response.status.protocol = buffer[2];
-		response.status.light_engine_state = buffer[3];
-		response.status.playback_state = buffer [4];
-		response.status.source = buffer[5];
-		response.status.light_engine_flags = bytesToUInt16(&buffer[6]);
-		response.status.playback_flags =  bytesToUInt16(&buffer[8]);
-		response.status.source_flags =  bytesToUInt16(&buffer[10]);
-		response.status.buffer_fullness = bytesToUInt16(&buffer[12]);
-		response.status.point_rate = bytesToUInt32(&buffer[14]);
-		response.status.point_count = bytesToUInt32(&buffer[18]);
-		
-        if((response.response == 'a') && (response.status.playback_state!= PLAYBACK_IDLE )) {
-            numPointsToSend = dacBufferSize - response.status.buffer_fullness;
-            if(numPointsToSend<0) numPointsToSend = 0;
-			
-//			// numpointstosend should be
-//			if((bufferedPoints.size()>minBuffer) && (numPointsToSend>bufferedPoints.size())) {
-//				numPointsToSend
-//			}
-			
-        }
-		if(verbose || (response.response!='a')) {
+	bool failed = false;
+	
+	lastMessageTimeMicros = ofGetElapsedTimeMicros();
+	// if there were other commands ahead of it then the time
+	// includes waiting for those, so it's not a fair round trip
+	bool fairroundtrip = false;
+	int numpoints = 0;
+	if(commandsInFlight.size()>0) {
+		latencyMicros = lastMessageTimeMicros - commandsInFlight.front().sentMicros;
+		fairroundtrip = !commandsInFlight.front().queued;
+		numpoints = commandsInFlight.front().numPoints;
+		commandsInFlight.pop_front();
+	} else {
+		ofLog(OF_LOG_WARNING, "DacEtherdream - got a response we weren't expecting");
+	}
+	
+	connected = true;
+	response.response = data[0];
+	response.command = data[1];
+	response.status.protocol = data[2];
+	response.status.light_engine_state = data[3];
+	response.status.playback_state = data[4];
+	response.status.source = data[5];
+	response.status.light_engine_flags = bytesToUInt16(&data[6]);
+	response.status.playback_flags =  bytesToUInt16(&data[8]);
+	response.status.source_flags =  bytesToUInt16(&data[10]);
+	response.status.buffer_fullness = bytesToUInt16(&data[12]);
+	response.status.point_rate = bytesToUInt32(&data[14]);
+	response.status.point_count = bytesToUInt32(&data[18]);
+	
+	// 'F' means the DAC refused the points because it was full
+	if((response.response=='F') && (response.command=='d')) {
+		bufferController.bufferFull(response.status.buffer_fullness, numpoints);
+	} else {
+		bufferController.updateCapacity(response.status.buffer_fullness);
+	}
+	// only the simple commands give us a fair measure of the network
+	if(fairroundtrip && (response.response == 'a') && ((response.command=='d') || (response.command=='?'))) {
+		bufferController.addRoundTrip(latencyMicros);
+	}
+	bufferController.update(response.status.point_rate>0 ? response.status.point_rate : pps);
+	dacBufferSize = bufferController.getFillTarget();
+	pointsToSendBeforePlaying = bufferController.getLowWaterMark();
+	
+	if(verbose || (response.response!='a')) {
             ofLog(OF_LOG_NOTICE, "response : "+ ofToString(response.response) +  " command : " + ofToString(response.command) );
             ofLog(OF_LOG_NOTICE, "num points sent : "+ ofToString(numPointsToSend) );
             
-			string data = "";
-			data+= "\nprotocol           : " + to_string(response.status.protocol) + "\n";
-			data+= "light_engine_state : " + light_engine_states[response.status.light_engine_state]+" "+to_string(response.status.light_engine_state) + "\n";
-			data+= "playback_state     : " + playback_states[response.status.playback_state]+" "+to_string(response.status.playback_state) + "\n";
-			data+= "source             : " + to_string(response.status.source) + "\n";
-			data+= "light_engine_flags : " + std::bitset<5>(response.status.light_engine_flags).to_string() + "\n";
-			data+= "playback_flags     : " + std::bitset<3>(response.status.playback_flags).to_string() + "\n";
-			data+= "source_flags       : " + to_string(response.status.source_flags) + "\n";
-			data+= "buffer_fullness    : " + to_string(response.status.buffer_fullness) + "\n";
-			data+= "point_rate         : " + to_string(response.status.point_rate) + "\n";
-			data+= "point_count        : " + to_string(response.status.point_count) + "\n";
-			
-			cout << data << endl;
+		string data = "";
+		data+= "\nprotocol           : " + to_string(response.status.protocol) + "\n";
+		// they're straight from the network so they could be anything
+		string lightenginestate = (response.status.light_engine_state<4) ? light_engine_states[response.status.light_engine_state] : "unknown";
+		string playbackstate = (response.status.playback_state<3) ? playback_states[response.status.playback_state] : "unknown";
+		data+= "light_engine_state : " + lightenginestate+" "+to_string(response.status.light_engine_state) + "\n";
+		data+= "playback_state     : " + playbackstate+" "+to_string(response.status.playback_state) + "\n";
+		data+= "source             : " + to_string(response.status.source) + "\n";
+		data+= "light_engine_flags : " + std::bitset<5>(response.status.light_engine_flags).to_string() + "\n";
+		data+= "playback_flags     : " + std::bitset<3>(response.status.playback_flags).to_string() + "\n";
+		data+= "source_flags       : " + to_string(response.status.source_flags) + "\n";
+		data+= "buffer_fullness    : " + to_string(response.status.buffer_fullness) + "\n";
+		data+= "point_rate         : " + to_string(response.status.point_rate) + "\n";
+		data+= "point_count        : " + to_string(response.status.point_count) + "\n";
+		
+		cout << data << endl;
             
             // EDGE CASE THAT WE NEED TO CATCH :
             
@@ -679,81 +944,77 @@ inline bool DacEtherdream::waitForAck(char command) {
                 
             }
                 
-		}
-		// things we /are/ interested in in this response data :
-		//
-		// light_engine_state :
-		// ====================
-		// 0 : ready
-		// 1 : warmup
-		// 2 : cooldown
-		// 3 : Emergency stop
-		//
-		// I've only ever seen it as 0, I don't think warmup and cooldown are implemented. Emergency stop
-		// only happens if you send a 0x00 command or an 0xff command (or any command it doesn't recognise
-		//
-		// light_engine_flags :
-		// ====================
-		// 00001 : Emergency stop due to E-Stop packet (or weird command)
-		// 00010 : Emergency stop due to E-Stop input to projector (not sure how etherdream would know?)
-		// 00100 : Emergency stop input to projector is currently active (no idea what this means)
-		// 01000 : Emergency stop due to over temperature (interesting... probably worth looking into...)
-		// 10000 : Emergency stop due to loss of Ethernet (not sure how we'd get the message? unless this is
-		//		   sent after a reconnection)
-		//
-		// playback_state :
-		// ================
-		// 0 : Idle
-		// 1 : Prepared
-		// 2 : Playing
-		//
-		// So zero is the default. In idle, you can't send point data.
-		// Prepared means we can start sending points
-		// Playing is when we're prepared, have sent data, and started streaming
-		//
-		// playback_flags :
-		// ================
-		// Bit # :
-		// 001 : Shutter state (1 for open, 0 for closed)
-		// 010 : Underflow - the most common, is 1 if the system runs out of points
-		// 100 : E-Stop - happens if you send a stop command (or any weird bytes). Worth keeping an eye on
-		//
-		// buffer_fullness :
-		// =================
-		// This is how many points are queued up in the buffer. Seems to be a limit of 1799.
-		//
-		// point_rate :
-		// ============
-		// whatever the current point rate is set to
-		//
-		// point_count :
-		// =============
-		// The number of points it has processed - I wonder what happens when this is clocked?
-		// It gets reset on a prepare.
-		//
-		// things we aren't interested in :
-		// ================================
-		// protocol - always seems to be zero
-		// source - always 0 for data stream. Could be 1 for ilda playback from SD card or 2 for internal abstract generator (no idea what that is but it sounds cool!)
-		// source_flags - no idea what this even is. No docs about it.
-		
-		
-	}
-	else {
-		ofLog(OF_LOG_NOTICE, "data received from Etherdream not 22 bytes :" + ofToString(n));
-		// what do we do now?
-		
 	}
+	// things we /are/ interested in in this response data :
+	//
+	// light_engine_state :
+	// ====================
+	// 0 : ready
+	// 1 : warmup
+	// 2 : cooldown
+	// 3 : Emergency stop
+	//
+	// I've only ever seen it as 0, I don't think warmup and cooldown are implemented. Emergency stop
+	// only happens if you send a 0x00 command or an 0xff command (or any command it doesn't recognise
+	//
+	// light_engine_flags :
+	// ====================
+	// 00001 : Emergency stop due to E-Stop packet (or weird command)
+	// 00010 : Emergency stop due to E-Stop input to projector (not sure how etherdream would know?)
+	// 00100 : Emergency stop input to projector is currently active (no idea what this means)
+	// 01000 : Emergency stop due to over temperature (interesting... probably worth looking into...)
+	// 10000 : Emergency stop due to loss of Ethernet (not sure how we'd get the message? unless this is
+	//		   sent after a reconnection)
+	//
+	// playback_state :
+	// ================
+	// 0 : Idle
+	// 1 : Prepared
+	// 2 : Playing
+	//
+	// So zero is the default. In idle, you can't send point data.
+	// Prepared means we can start sending points
+	// Playing is when we're prepared, have sent data, and started streaming
+	//
+	// playback_flags :
+	// ================
+	// Bit # :
+	// 001 : Shutter state (1 for open, 0 for closed)
+	// 010 : Underflow - the most common, is 1 if the system runs out of points
+	// 100 : E-Stop - happens if you send a stop command (or any weird bytes). Worth keeping an eye on
+	//
+	// buffer_fullness :
+	// =================
+	// This is how many points are queued up in the buffer. Seems to be a limit of 1799.
+	//
+	// point_rate :
+	// ============
+	// whatever the current point rate is set to
+	//
+	// point_count :
+	// =============
+	// The number of points it has processed - I wonder what happens when this is clocked?
+	// It gets reset on a prepare.
+	//
+	// things we aren't interested in :
+	// ================================
+	// protocol - always seems to be zero
+	// source - always 0 for data stream. Could be 1 for ilda playback from SD card or 2 for internal abstract generator (no idea what that is but it sounds cool!)
+	// source_flags - no idea what this even is. No docs about it.
 	
-	if(failed) {
-		beginSent = false;
-		connected = false;
-		
-		return false;
-	} else {
-		
-		return true;
-	}
+	// the DAC thread doesn't hold the lock while it's working, so copy
+	// what getDisplayData needs
+	while(!lock()) {}
+	displayStatus.bufferFullness = response.status.buffer_fullness;
+	displayStatus.pointRate = response.status.point_rate;
+	displayStatus.lastMessageTimeMicros = lastMessageTimeMicros;
+	displayStatus.latencyMicros = latencyMicros;
+	displayStatus.bufferTarget = dacBufferSize;
+	displayStatus.capacity = bufferController.getCapacity();
+	displayStatus.prepareSendCount = prepareSendCount;
+	unlock();
+	
+	return !failed;
 }
 
 string DacEtherdream ::getLabel(){
@@ -761,7 +1022,7 @@ string DacEtherdream ::getLabel(){
 }
 
 ofColor DacEtherdream :: getStatusColour(){
-	if(!connected) return ofColor::red;
+	if((connectionState==ETHERDREAM_CONNECTING) || (connectionState==ETHERDREAM_BACKOFF)) return ofColor::red;
 	if(response.status.playback_state <=1) return ofColor::orange;
 	else if(response.status.playback_state ==2) return ofColor::green;
 	else return ofColor::red;
@@ -819,29 +1080,21 @@ void DacEtherdream :: logData() {
     data+= "\n";
     int numpoints =bytesToUInt16(&outbuffer[1]);
     data+= "num points         : " + to_string(numpoints) + "\n";
-    int pos = 3;
     
-    for(int i = 0; i<numpoints; i++) {
+    // only kept in verbose mode
+    for(int i = 0; (i<numpoints) && (i<loggedPoints.size()); i++) {
+        dac_point& p = loggedPoints[i];
         data+= "------------------------------ npoint # " + to_string(i) + "\n";
         
-        data+= " ctl : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " x   : " + to_string(bytesToInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " y   : " + to_string(bytesToInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " r   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " g   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " b   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " i   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " u1   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
-        data+= " u2   : " + to_string(bytesToUInt16(&outbuffer[pos])) + "\n";
-        pos+=2;
+        data+= " ctl : " + to_string(bytesToUInt16((const unsigned char*)&p.control)) + "\n";
+        data+= " x   : " + to_string((int16_t)bytesToUInt16((const unsigned char*)&p.x)) + "\n";
+        data+= " y   : " + to_string((int16_t)bytesToUInt16((const unsigned char*)&p.y)) + "\n";
+        data+= " r   : " + to_string(bytesToUInt16((const unsigned char*)&p.r)) + "\n";
+        data+= " g   : " + to_string(bytesToUInt16((const unsigned char*)&p.g)) + "\n";
+        data+= " b   : " + to_string(bytesToUInt16((const unsigned char*)&p.b)) + "\n";
+        data+= " i   : " + to_string(bytesToUInt16((const unsigned char*)&p.i)) + "\n";
+        data+= " u1   : " + to_string(bytesToUInt16((const unsigned char*)&p.u1)) + "\n";
+        data+= " u2   : " + to_string(bytesToUInt16((const unsigned char*)&p.u2)) + "\n";
     }
     cout << data << endl;
     
@@ -866,20 +1119,24 @@ bool DacEtherdream :: sendClear(){
 }
 
 bool DacEtherdream :: sendBytes(const void* buffer, int length) {
+	return sendBytes(buffer, length, NULL, NULL, 0);
+}
+
+bool DacEtherdream :: sendBytes(const void* buffer, int headerlength, const dac_point** points, const int* numpoints, int numblocks) {
 	
 	int numBytesSent = 0;
 	bool failed = false;
-	bool networkerror = false;
     startTime = ofGetElapsedTimeMicros();//  count = 0;
+	
+	int length = headerlength;
+	for(int i = 0; i<numblocks; i++) length+=numpoints[i]*sizeof(dac_point);
 
 	try {
-		numBytesSent = socket.sendBytes(buffer, length);
-	}
-	catch (Poco::Exception& exc) {
-		//Handle your network errors.
-		cerr << "sendBytes : Network error: " << exc.displayText() << endl;
-		networkerror = true;
-		failed = true;
+		if(numblocks==0) {
+			numBytesSent = socket.sendBytes(buffer, length);
+		} else {
+			numBytesSent = sendGathered(buffer, headerlength, points, numpoints, numblocks);
+		}
 	}
 	catch (Poco::TimeoutException& exc) {
 		//Handle your network errors.
@@ -887,6 +1144,11 @@ bool DacEtherdream :: sendBytes(const void* buffer, int length) {
 		//	isOpen = false;
 		failed = true;
 	}
+	catch (Poco::Exception& exc) {
+		//Handle your network errors.
+		cerr << "sendBytes : Network error: " << exc.displayText() << endl;
+		failed = true;
+	}
 	if(numBytesSent!=length) {
 		//do something!
 		cerr << "send fail, fewer bytes sent than expected : "<< numBytesSent << endl;
@@ -898,14 +1160,24 @@ bool DacEtherdream :: sendBytes(const void* buffer, int length) {
 	}
 	
 	if(failed) {
-		if(networkerror) {
-			closeWhileRunning();
-			setup(ipaddress);
-		}
+		// if any of it didn't go, the DAC's got part of a command and
+		// will read whatever we send next as the rest of it, so the
+		// only way back is a new connection. The thread will notice
+		// and reconnect.
+		connected = false;
 		beginSent = false;
 		//prepareSent = false;
 		return false;
 	}
+	
+	// keep track of it so we can match up the response
+	EtherdreamCommand command;
+	command.command = ((const uint8_t*)buffer)[0];
+	command.numPoints = (command.command=='d') ? bytesToUInt16(&((const uint8_t*)buffer)[1]) : 0;
+	command.sentMicros = startTime;
+	command.queued = commandsInFlight.size()>0;
+	commandsInFlight.push_back(command);
+	
 	return true;
 }
 //bool DacEtherdream :: receiveBytes(const void* buffer, int length) {
@@ -923,25 +1195,3 @@ bool DacEtherdream :: sendBytes(const void* buffer, int length) {
 //		//	isOpen = false;
 //	}
 //}
-
-dac_point*  DacEtherdream :: getDacPoint() {
-	dac_point* p;
-	if(sparePoints.size()==0) {
-		p= new dac_point();
-		//ofLog(OF_LOG_NOTICE, "new point made");
-	} else {
-		p = sparePoints.back();
-		sparePoints.pop_back();
-		
-	}
-	p->control =
-	p->x =
-	p->y =
-	p->r =
-	p->g =
-	p->b =
-	p->i =
-	p->u1 =
-	p->u2 = 0;
-	return p;
-	}
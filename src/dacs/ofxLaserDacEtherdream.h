@@ -9,6 +9,9 @@
 
 #pragma once
 #include "ofxLaserDacBase.h"
+#include "RingBuffer.h"
+#include "TripleBuffer.h"
+#include "ofxLaserEtherdreamBufferController.h"
 
 #include "Poco/Net/SocketAddress.h"
 #include "Poco/Net/SocketStream.h"
@@ -17,6 +20,9 @@
 
 #ifdef TARGET_WIN32
 #include <Windows.h>
+#else
+#include <sys/uio.h>
+#include <errno.h>
 #endif
 
 
@@ -52,6 +58,23 @@ struct dac_response {
 	struct dac_status status;
 };
 
+// a command that we've sent but haven't had the response to yet
+struct EtherdreamCommand {
+	uint8_t command;
+	int numPoints; // for data commands
+	uint64_t sentMicros;
+	bool queued; // true if there were already other commands in flight
+};
+
+// the DAC thread goes through these in order, and back to
+// ETHERDREAM_BACKOFF if the connection fails
+enum EtherdreamConnectionState {
+	ETHERDREAM_CONNECTING,
+	ETHERDREAM_CONNECTED, // but not playing yet
+	ETHERDREAM_PLAYING,
+	ETHERDREAM_BACKOFF // waiting before we try to connect again
+};
+
 struct begin_command {
 	uint8_t command; /* 'b' (0x62) */
 	uint16_t low_water_mark;
@@ -84,6 +107,15 @@ struct dac_point {
 	
 };
 
+// dac_point is laid out exactly like a point in the etherdream's data
+// command (nine 16 bit little endian values, no padding), so on a little
+// endian machine we can send them straight out of memory.
+static_assert(sizeof(dac_point)==18, "dac_point must match the etherdream wire format");
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define ETHERDREAM_BIG_ENDIAN_HOST
+#endif
+
 
 
 
@@ -97,14 +129,20 @@ namespace ofxLaser {
 		~DacEtherdream();
 		
 		// DacBase functions
-		bool sendFrame(const vector<Point>& points);
-        bool sendPoints(const vector<Point>& points);
+		bool sendFrame(const PointBuffer& points);
+        bool sendPoints(const PointBuffer& points);
+		// anything that still sends vectors of Points
+		bool sendFrame(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendFrame(adapterBuffer); };
+		bool sendPoints(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendPoints(adapterBuffer); };
 		bool setPointsPerSecond(uint32_t newpps);
 		string getLabel();
 		ofColor getStatusColour();
 		const vector<ofAbstractParameter*>& getDisplayData();
+		bool isFrameWaiting() { return frameBuffers.hasNewFrame(); };
 		
-		void setup(string ip);
+		// doesn't wait for the connection, that happens in the DAC's
+		// thread and it keeps trying until it's closed
+		void setup(string ip, int port = 7765);
 		//bool addPoints(const vector<dac_point> &points );
 		bool addPoint(const dac_point &point );
 		void closeWhileRunning();
@@ -116,27 +154,51 @@ namespace ofxLaser {
         //output the data that we just sent
         void logData();
 		
-		// simple object pooling system
-		dac_point* getDacPoint();
-		
+		ofParameter<string> connectionStatusDisplay;
 		ofParameter<int> pointBufferDisplay;
+		ofParameter<int> bufferTargetDisplay;
 		ofParameter<int> latencyDisplay;
 		ofParameter<int> reconnectCount;
 		uint64_t lastMessageTimeMicros;
 		
         
-		// the maximum number of points the etherdream can hold.
-		// in etherdream v1 it's 1799, but you may want it to be lower
-		// for lower latency
+		// how much time's worth of points to keep in the etherdream's
+		// buffer. It'll use more if the network can't keep up with that.
+		void setTargetLatency(float millis) { bufferController.setTargetLatency(millis); };
+		float getTargetLatency() { return bufferController.getTargetLatency(); };
+		// extra safety time on top of what the network needs
+		void setJitterMargin(float millis) { bufferController.setJitterMargin(millis); };
+		
+		// the number of points we fill the etherdream's buffer to, and the
+		// minimum number of points in the buffer before it starts playing.
+		// These are set by the bufferController every time the DAC
+		// responds, so use setTargetLatency rather than changing them.
 		int dacBufferSize;
-		// the minimum number of points in the buffer before the etherdream
-		// starts playing.
 		int pointsToSendBeforePlaying;
+		
+		// how many commands we can send before we get the responses back.
+		// More means it copes better with slow networks, but each one
+		// adds more points to the DAC's buffer.
+		int maxCommandsInFlight = 3;
+		// if we've not heard from it for this long then ping it
+		int pingIntervalMicros = 50000;
+		
+		// how long to wait for it to connect, and then how long to wait
+		// before trying again, which doubles every time it fails
+		int connectTimeoutMillis = 1000;
+		int minBackoffMillis = 100;
+		int maxBackoffMillis = 5000;
 
-		vector<dac_point> framePoints;
+		// frames from sendFrame, the DAC thread replays the latest one
+		// until there's a new one
+		TripleBuffer<vector<dac_point>> frameBuffers;
 		
 	private:
 		void threadedFunction();
+		
+		bool connectToDac();
+		void disconnect();
+		void startBackoff();
 
 		inline bool sendBegin();
 		inline bool sendPrepare();
@@ -146,14 +208,30 @@ namespace ofxLaser {
 		bool sendStop();
 		bool sendClear();
 		inline bool sendPointRate(uint32_t rate);
-		inline bool waitForAck(char command);
+		// gives up if the thread is stopped, unless stopwiththread is false
+		inline bool waitForAck(char command, bool stopwiththread = true);
+		// reads and processes any responses, if wait is true then waits for
+		// at least some data to arrive. Returns false if the connection failed.
+		bool receiveResponses(bool wait);
+		bool processResponse(const uint8_t* data);
+		// waits until there's something to read, or the time's up
+		void waitForResponses(int micros);
+		void clearCommandsInFlight();
+		int estimateBufferFullness();
 		bool sendBytes(const void* buffer, int length);
+		// sends the header followed by up to 3 blocks of points, without
+		// copying them into one buffer first
+		bool sendBytes(const void* header, int headerlength, const dac_point** points, const int* numpoints, int numblocks);
+		int sendGathered(const void* header, int headerlength, const dac_point** points, const int* numpoints, int numblocks);
+		// swaps the bytes on big endian machines, does nothing otherwise
+		static void pointsToWireFormat(dac_point* points, int count);
 		
 		dac_point lastpoint;
-		dac_point sendpoint;
+		// blank points to pad out a data command if we run out
+		vector<dac_point> blankPoints;
 		
 		uint8_t buffer[1024];
-		uint8_t outbuffer[100000];
+		uint8_t outbuffer[16];
         int numBytesSent;
 		
 		Poco::Net::StreamSocket socket;
@@ -162,24 +240,49 @@ namespace ofxLaser {
 		string playback_states[3] = {"idle", "prepared", "playing"};
 		
 		dac_response response;
+		deque<EtherdreamCommand> commandsInFlight;
+		// responses come in as a stream, not always one at a time
+		uint8_t responseBuffer[22*64];
+		int responseBufferSize = 0;
+		int estimatedBufferFullness = 0;
+		EtherdreamBufferController bufferController;
+		// a copy of what getDisplayData needs, only touched with the lock
+		struct {
+			int bufferFullness = 0;
+			uint32_t pointRate = 0;
+			uint64_t lastMessageTimeMicros = 0;
+			int latencyMicros = 0;
+			int bufferTarget = 0;
+			int capacity = 1799;
+			int prepareSendCount = 0;
+		} displayStatus;
 		int latencyMicros = 0;
 		int prepareSendCount = 0;
         uint64_t startTime; // to measure latency
 		bool beginSent;
 		
 		string ipaddress; 
+		int port = 7765;
+		std::atomic<int> connectionState{ETHERDREAM_CONNECTING};
+		std::atomic<uint64_t> nextConnectTimeMicros{0};
+		std::atomic<int> connectAttempts{0};
+		std::atomic<int> connectTimeMillis{0};
+		int backoffMillis = 100;
 		
-		deque<dac_point*> bufferedPoints;
-		vector<dac_point*> sparePoints;
+		// the points waiting to go to the DAC. It's only ever filled from
+		// one thread - the DAC thread copies the frame into it in frame
+		// mode, otherwise sendPoints adds to it from the app thread.
+		RingBuffer<dac_point> bufferedPoints;
 		int numPointsToSend;
 		uint32_t pps, newPPS;
 		int queuedPPSChangeMessages;
 		bool connected; 
 		//bool replayFrames = true;
 		//bool isReplaying = false;
-		bool newFrame = false; 
-		bool frameMode = true;
+		bool newFrame = false; // only used by the DAC thread
+		std::atomic<bool> frameMode{true};
 		bool verbose = false;
+		vector<dac_point> loggedPoints; // the last points we sent, for logData
 		  
 		
 	};
@@ -10,13 +10,27 @@
 
 using namespace ofxLaser;
 
+constexpr int IDNJitterHistogram::binEdges[];
+
+int IDNJitterHistogram :: getPercentileMicros(float fraction) const {
+	uint32_t total = 0;
+	for(int i = 0; i<numBins; i++) total+=counts[i];
+	if(total==0) return 0;
+	
+	uint32_t target = ceil(total*fraction);
+	uint32_t count = 0;
+	for(int i = 0; i<numBins-1; i++) {
+		count+=counts[i];
+		if(count>=target) return binEdges[i];
+	}
+	return -1;
+}
+
 void DacIDN :: setup(string ip) {
 	
 	
 	pps = 30000;
-	newFrameIsBuffered = false;
-	lastFrameTime = 0;
-	lastFrameDuration = 0;
+	frameEndTime = std::chrono::steady_clock::now();
 	connected = false;
 	counter = 0;
 	
@@ -35,6 +49,17 @@ void DacIDN :: setup(string ip) {
 	}
 	
 	
+	jitterDisplay.set("Jitter", "");
+	lateFramesDisplay.set("Late frames", "");
+	pointBufferDisplay.set("Point Buffer", 0, 0, 1500);
+	waveDisplay.set("Wave", "");
+	displayData.clear();
+	displayData.push_back(&jitterDisplay);
+	displayData.push_back(&lateFramesDisplay);
+	
+	// half a second at the highest point rate
+	waveBuffer.setCapacity(1<<16);
+	
 	if(connected) {
 		
 		startThread();
@@ -52,32 +77,62 @@ void DacIDN :: setup(string ip) {
 	}
 }
 
-bool DacIDN :: sendFrame(const vector<Point>& points) {
+bool DacIDN :: sendFrame(const PointBuffer& points) {
 	
-	pointsToSend.resize(points.size());
+	// no lock needed, this buffer is ours until we publish it
+	vector<IDN_point>& frame = frameBuffers.getWriteBuffer();
+	frame.resize(points.size());
 	
 	for(int i = 0; i<points.size(); i++) {
-		IDN_point& p1 = pointsToSend[i];
-		Point p2 = points[i];
-		p1.x = ofMap(p2.x,0,800,IDN_MIN, IDN_MAX, true);
-		p1.y = ofMap(p2.y,800,0,IDN_MIN, IDN_MAX, true); // Y is UP in ilda specs
-		p1.r = p2.r;
-		p1.g = p2.g;
-		p1.b = p2.b;
+		convertPoint(points, i, frame[i]);
 	}
 	
-	if(lock()) {
-		newFrameIsBuffered = true;
-		unlock();
+	frameBuffers.publish();
+	frameMode = true;
+	
+	// locking the mutex, even for no time at all, means the thread is
+	// either already waiting or hasn't checked for a frame yet, so it
+	// can't miss this
+	{
+		std::lock_guard<std::mutex> framelock(frameMutex);
 	}
+	frameCondition.notify_one();
     
     return true;
 };
 
-bool DacIDN :: sendPoints(const vector<Point>& points) {
-	return false;
+bool DacIDN :: sendPoints(const PointBuffer& points) {
+	
+	// no more than half a second ahead, like the other DACs
+	if((waveBuffer.getSpace()<points.size()) || (waveBuffer.size()+points.size()>pps*0.5)) {
+		return false;
+	}
+	
+	IDN_point p1;
+	for(int i = 0; i<points.size(); i++) {
+		convertPoint(points, i, p1);
+		waveBuffer.push(p1);
+	}
+	
+	if(frameMode) {
+		// wake the thread up in case it's waiting for a frame
+		frameMode = false;
+		{
+			std::lock_guard<std::mutex> framelock(frameMutex);
+		}
+		frameCondition.notify_one();
+	}
+	return true;
 };
 
+inline void DacIDN :: convertPoint(const PointBuffer& points, int i, IDN_point& p) {
+	p.x = ofMap(points.x[i],0,800,IDN_MIN, IDN_MAX, true);
+	p.y = ofMap(points.y[i],800,0,IDN_MIN, IDN_MAX, true); // Y is UP in ilda specs
+	p.r = points.r[i];
+	p.g = points.g[i];
+	p.b = points.b[i];
+}
+
 bool DacIDN :: setPointsPerSecond(uint32_t newpps) {
 	pps = newpps;
     return true;
@@ -86,194 +141,477 @@ bool DacIDN :: setPointsPerSecond(uint32_t newpps) {
 void DacIDN :: threadedFunction(){
 	
 	while(isThreadRunning()) {
+		if(frameMode) {
+			playFrame();
+		} else {
+			playWave();
+		}
+	}
+}
+
+void DacIDN :: playFrame(){
+	
+	using namespace std::chrono;
+	
+	bool late = false;
+	{
+		std::unique_lock<std::mutex> framelock(frameMutex);
 		
 		// wait for the last frame to finish...
-		unsigned usWait = lastFrameDuration - (ofGetElapsedTimeMicros() - lastFrameTime);
-		if((int)usWait > 0) sleep(usWait/1000);
+		frameCondition.wait_until(framelock, frameEndTime, [this]{ return !isThreadRunning() || !frameMode; });
 		
-		// and also wait until we have a new frame!
-		while(!newFrameIsBuffered) {
-			//send void to keep alive?
-			// sendVoid();
-			sleep(1);
+		// and also wait until we have a new frame! (it checks every
+		// now and then in case the thread's stopped without telling us)
+		while(!frameBuffers.hasNewFrame() && isThreadRunning() && frameMode) {
+			late = true;
+			frameCondition.wait_for(framelock, milliseconds(100));
 		}
-		
-		bufferedPoints.resize(pointsToSend.size());
-		// now we have new frames so send them!
-		while(!lock()); // wait until we have lock
-		lastFrameTime = ofGetElapsedTimeMicros();
-		lastFrameDuration = (((uint64_t)(pointsToSend.size() - 1)) * 1000000ull) / (uint64_t)pps;
-		// copy the points into the buffer
-		for(int i = 0; i<pointsToSend.size(); i++) {
-			bufferedPoints[i] = pointsToSend[i];
+	}
+	if(!isThreadRunning() || !frameMode) return;
+	
+	// throw away anything left over from streaming points, and start
+	// the frame timing again
+	if(waveStarted) {
+		waveBuffer.clear();
+		waveStarted = false;
+		firstFrame = true;
+		late = true;
+	}
+	
+	// swap in the new frame. The read buffer is only used by this
+	// thread so no need to lock or copy anything
+	frameBuffers.update();
+	steady_clock::time_point now = steady_clock::now();
+	
+	if(late) {
+		// nothing to send when the last one finished, so this one
+		// starts now
+		if(!firstFrame) {
+			std::lock_guard<std::mutex> histogramlock(histogramMutex);
+			jitterHistogram.lateFrames++;
 		}
-		newFrameIsBuffered = false;
-		unlock();
-		// now it's safe to send the buffered points
-		sendFrameToDac();
-		yield();
+		frameEndTime = now;
+	} else {
+		// how long after the end of the last frame did we wake up
+		int jittermicros = duration_cast<microseconds>(now-frameEndTime).count();
+		int bin = 0;
+		while((bin<IDNJitterHistogram::numBins-1) && (jittermicros>IDNJitterHistogram::binEdges[bin])) bin++;
+		std::lock_guard<std::mutex> histogramlock(histogramMutex);
+		jitterHistogram.counts[bin]++;
 	}
+	firstFrame = false;
+	
+	// the next frame is due when this one ends, counted from when it
+	// should have started rather than when we woke up, so the wake up
+	// delays don't add up
+	int numpoints = frameBuffers.getReadBuffer().size();
+	uint64_t framemicros = (((uint64_t)MAX(numpoints - 1, 0)) * 1000000ull) / (uint64_t)pps;
+	frameEndTime += microseconds(framemicros);
+	
+	sendFrameToDac();
+	
+	// the DAC repeats the frame until it gets another one, so we
+	// want the next one by the time this one has finished
+	int64_t microsleft = duration_cast<microseconds>(frameEndTime-steady_clock::now()).count();
+	setFrameNeededTime(ofGetElapsedTimeMicros() + MAX(microsleft, 0));
 }
 
-void DacIDN :: sendFrameToDac() {
+void DacIDN :: playWave(){
+	
+	using namespace std::chrono;
+	
+	// in case we get a frame in pull mode, we don't know when we'll need it
+	setFrameNeededTime(0);
 	
-	int pointIndex = 0;
-	int numPointsToSend = bufferedPoints.size();
-	int packetsSent = 0;
+	if(mtu!=currentMtu) updateMaxPacketSize();
 	
-	// 7 bytes in a point, max bytes is 9000
-	// 9000 / 7 is max points, let's say 1200
-	int maxPointsPerFragment = 1200;
+	steady_clock::time_point now = steady_clock::now();
 	
-	int fragmentsToSend = ceil((float)numPointsToSend/(float)maxPointsPerFragment);
+	// if we've only just started, or the thread got held up for so long
+	// that the DAC's run out, start the wave again from now
+	if(waveEndTime<now) {
+		if(waveStarted) waveLateCount++;
+		waveConfigTime = steady_clock::time_point();
+		waveEndTime = now;
+		waveStarted = true;
+	}
+	
+	uint32_t rate = pps;
 	
-	if(verbose) ofLog(OF_LOG_NOTICE, "FRAGMENTS TO SEND : " + ofToString(fragmentsToSend));
+	// if the app's got too far ahead, skip the oldest points so the
+	// latency doesn't keep growing
+	size_t maxqueued = (size_t)(rate*waveMaxQueueMillis/1000.0f);
+	size_t queued = waveBuffer.getAvailable();
+	if(queued>maxqueued) {
+		waveBuffer.discard(queued-maxqueued);
+		waveDroppedCount+=queued-maxqueued;
+	}
 	
-	uint64_t time = ofGetElapsedTimeMicros();
+	// each chunk is one packet, with room for the config in it
+	int chunkpoints = ofClamp((uint64_t)rate*waveChunkMicros/1000000ull, 1, (maxPacketSize-36)/7);
 	
-	for(int i = 0; i<fragmentsToSend; i++){
+	// keep sending chunks until we're waveLatencyMillis ahead of the DAC
+	steady_clock::time_point sendupto = now + microseconds((int)(waveLatencyMillis*1000));
+	int numpackets = 0;
+	while(waveEndTime<sendupto) {
+		if(packetBuffer.size()<(numpackets+1)*maxPacketSize) packetBuffer.resize((numpackets+1)*maxPacketSize);
+		if(packetSizes.size()<numpackets+1) packetSizes.resize(numpackets+1);
 		
-		string output;
+		// the DAC needs the config every now and then in case it missed it
+		bool sendconfig = (waveEndTime-waveConfigTime > milliseconds(200));
+		if(sendconfig) waveConfigTime = waveEndTime;
 		
+		waveEndTime += microseconds(buildWaveChunk(numpackets, chunkpoints, rate, sendconfig));
+		numpackets++;
+	}
+	if(numpackets>0) sendPackets(numpackets);
+	
+	// and sleep until we're back down to the latency
+	std::unique_lock<std::mutex> framelock(frameMutex);
+	frameCondition.wait_until(framelock, waveEndTime - microseconds((int)(waveLatencyMillis*1000)), [this]{ return !isThreadRunning() || frameMode; });
+}
+
+uint32_t DacIDN :: buildWaveChunk(int packetindex, int numpoints, uint32_t rate, bool sendconfig) {
+	
+	using namespace std::chrono;
+	
+	uint8_t* packet = packetBuffer.data() + packetindex*maxPacketSize;
+	uint8_t* data = packet;
+	
+	*data++ = 0x40;
+	*data++ = 0x00;
+	*data++ = (uint8_t)(counter>>8);
+	*data++ = (uint8_t)counter;
+	counter++;
+	
+	// size goes in at the end
+	data+=2;
+	
+	// CNL, with the configuration bit if we're sending it
+	*data++ = sendconfig ? 0xc0 : 0x80;
+	// CHUNK TYPE 0x01 - Wave samples
+	*data++ = 0x01;
+	
+	// TIME STAMP - when this chunk starts playing
+	uint32_t time = duration_cast<microseconds>(waveEndTime.time_since_epoch()).count();
+	*data++ = (uint8_t)(time >> 24);
+	*data++ = (uint8_t)(time >> 16);
+	*data++ = (uint8_t)(time >> 8);
+	*data++ = (uint8_t)time;
+	
+	if(sendconfig) {
+		// the same as for frames, except for the mode which is
+		// continuous graphics (0x01)
+		static const uint8_t channelconfig[20] = {
+			0x04, 0x01, 0x00, 0x01,
+			0x42, 0x00, 0x40, 0x10,
+			0x42, 0x10, 0x40, 0x10,
+			0x52, 0x7e, 0x52, 0x14,
+			0x51, 0xcc, 0x00, 0x00 };
+		memcpy(data, channelconfig, sizeof(channelconfig));
+		data+=sizeof(channelconfig);
+	}
+	
+	// sample chunk header, no flags then the duration
+	uint32_t chunkmicros = ((uint64_t)numpoints*1000000ull)/rate;
+	*data++ = 0x00;
+	*data++ = (uint8_t)(chunkmicros >> 16);
+	*data++ = (uint8_t)(chunkmicros >> 8);
+	*data++ = (uint8_t)chunkmicros;
+	
+	// the points go straight from the queue into the packet
+	IDN_point* first;
+	IDN_point* second;
+	size_t firstcount, secondcount;
+	int available = waveBuffer.peek(numpoints, first, firstcount, second, secondcount);
+	for(int i = 0; i<available; i++) {
+		lastWavePoint = (i<firstcount) ? first[i] : second[i-firstcount];
+		*data++ = (uint8_t)(lastWavePoint.x >> 8);
+		*data++ = (uint8_t)lastWavePoint.x;
+		*data++ = (uint8_t)(lastWavePoint.y >> 8);
+		*data++ = (uint8_t)lastWavePoint.y;
+		*data++ = lastWavePoint.r;
+		*data++ = lastWavePoint.g;
+		*data++ = lastWavePoint.b;
+	}
+	waveBuffer.discard(available);
+	
+	// not enough points from the app, so stay where we are with the laser off
+	if((available<numpoints) && !waveStarving) waveStarvedCount++;
+	waveStarving = (available<numpoints);
+	if(available<numpoints) {
+		for(int i = available; i<numpoints; i++) {
+			*data++ = (uint8_t)(lastWavePoint.x >> 8);
+			*data++ = (uint8_t)lastWavePoint.x;
+			*data++ = (uint8_t)(lastWavePoint.y >> 8);
+			*data++ = (uint8_t)lastWavePoint.y;
+			*data++ = 0;
+			*data++ = 0;
+			*data++ = 0;
+		}
+	}
+	
+	int packetsize = data - packet;
+	int messagesize = packetsize-4;
+	packet[4] = (uint8_t)(messagesize>>8);
+	packet[5] = (uint8_t)messagesize;
+	packetSizes[packetindex] = packetsize;
+	
+	return chunkmicros;
+}
+
+const vector<ofAbstractParameter*>& DacIDN :: getDisplayData() {
+	
+	IDNJitterHistogram histogram = getJitterHistogram();
+	int median = histogram.getPercentileMicros(0.5);
+	int p99 = histogram.getPercentileMicros(0.99);
+	jitterDisplay = "Jitter 50% "+(median<0 ? "2ms+" : ofToString(median)+"us")+" 99% "+(p99<0 ? "2ms+" : ofToString(p99)+"us");
+	lateFramesDisplay = "Late frames "+ofToString(histogram.lateFrames);
+	
+	pointBufferDisplay.setMax(MAX(1, pps*waveMaxQueueMillis/1000.0f));
+	pointBufferDisplay = waveBuffer.size();
+	waveDisplay = "Starved "+ofToString(waveStarvedCount)+" skipped "+ofToString(waveDroppedCount)+" late "+ofToString(waveLateCount);
+	
+	// show whichever's relevant for the mode we're in
+	displayData.clear();
+	if(frameMode) {
+		displayData.push_back(&jitterDisplay);
+		displayData.push_back(&lateFramesDisplay);
+	} else {
+		displayData.push_back(&pointBufferDisplay);
+		displayData.push_back(&waveDisplay);
+	}
+	return displayData;
+}
+
+void DacIDN :: resetDisplayData() {
+	waveStarvedCount = 0;
+	waveDroppedCount = 0;
+	waveLateCount = 0;
+	std::lock_guard<std::mutex> histogramlock(histogramMutex);
+	jitterHistogram = IDNJitterHistogram();
+}
+
+IDNJitterHistogram DacIDN :: getJitterHistogram() {
+	std::lock_guard<std::mutex> histogramlock(histogramMutex);
+	return jitterHistogram;
+}
+
+void DacIDN :: sendFrameToDac() {
+	
+	// pick up any change to the MTU
+	if(mtu!=currentMtu) updateMaxPacketSize();
+	
+	int numpackets = buildPackets(frameBuffers.getReadBuffer());
+	if(numpackets>0) sendPackets(numpackets);
+	
+}
+
+void DacIDN :: updateMaxPacketSize(bool toobig) {
+	
+	currentMtu = mtu;
+	int pathmtu = currentMtu;
+	
+#ifdef __linux__
+	int fd = udpConnection.getSocket();
+	// never let the network split our packets up, if the path MTU gets
+	// smaller the send fails with EMSGSIZE and we come back here
+	int discover = IP_PMTUDISC_DO;
+	setsockopt(fd, IPPROTO_IP, IP_MTU_DISCOVER, &discover, sizeof(discover));
+	// if the packets were too big then the network knows better than
+	// whatever MTU we were given
+	if((pathmtu<=0) || toobig) {
+		int discovered = 0;
+		socklen_t len = sizeof(discovered);
+		if((getsockopt(fd, IPPROTO_IP, IP_MTU, &discovered, &len)==0) && (discovered>0)) {
+			pathmtu = (pathmtu>0) ? MIN(pathmtu, discovered) : discovered;
+		}
+	}
+	// it still didn't fit and we don't know any better, so try the
+	// usual ethernet size (or half what we had if it was already that)
+	if(toobig && (pathmtu>=maxPacketSize+28)) {
+		pathmtu = (maxPacketSize+28>1500) ? 1500 : (maxPacketSize+28)/2;
+	}
+#endif
+	if(pathmtu<=0) pathmtu = 1500;
+	
+	// minus 20 bytes of IP header and 8 of UDP header, and there has
+	// to be room for the headers and at least one point
+	maxPacketSize = ofClamp(pathmtu - 28, 64, 65507);
+	
+	ofLog(OF_LOG_NOTICE, "DacIDN - MTU "+ofToString(pathmtu)+", max packet size "+ofToString(maxPacketSize));
+}
+
+int DacIDN :: buildPackets(const vector<IDN_point>& points) {
+	
+	// the first packet has the channel config and frame header in it, so
+	// it has 36 bytes of headers, the others have 12. Then it's 7 bytes
+	// per point : XXYYRGB
+	const int headersize = 12;
+	const int firstheadersize = 36;
+	int firstpacketpoints = (maxPacketSize-firstheadersize)/7;
+	int packetpoints = (maxPacketSize-headersize)/7;
+	
+	int numpoints = points.size();
+	// nothing to send
+	if(numpoints==0) return 0;
+	int numpackets = 1;
+	if(numpoints>firstpacketpoints) {
+		numpackets += (numpoints-firstpacketpoints+packetpoints-1)/packetpoints;
+	}
+	
+	if(packetBuffer.size()<numpackets*maxPacketSize) packetBuffer.resize(numpackets*maxPacketSize);
+	packetSizes.resize(numpackets);
+	
+	uint32_t time = ofGetElapsedTimeMicros();
+	// THIS IS WHAT SETS THE POINT SPEED
+	// the frame duration in microseconds, number of points / point rate
+	uint32_t framemicros = (((uint64_t)MAX(numpoints - 1, 0)) * 1000000ull) / (uint64_t)pps;
+	
+	int pointindex = 0;
+	
+	for(int i = 0; i<numpackets; i++) {
 		
-		output.push_back(0x40);
-		output.push_back(0x00);
-		output.push_back( (uint8_t)(counter>>8 ) );
-		output.push_back( (uint8_t) counter);
+		uint8_t* packet = packetBuffer.data() + i*maxPacketSize;
+		uint8_t* data = packet;
+		bool first = (i==0);
+		bool last = (i==numpackets-1);
 		
-		//PACKET SIZE minus first four bytes - populate it later!
-		output.push_back(0x00);
-		output.push_back(0x00);
+		*data++ = 0x40;
+		*data++ = 0x00;
+		*data++ = (uint8_t)(counter>>8);
+		*data++ = (uint8_t)counter;
+		counter++;
 		
-		bool sendConfig = (i==0);
+		// PACKET SIZE minus first four bytes - filled in at the end
+		data+=2;
 		
 		// CNL with configuration bit set (0x80 | 0x40) = 0xC0;
 		// also set with last fragment. Weird.
-		if(sendConfig || (i==fragmentsToSend-1))
-			output.push_back(0xc0);
-		else
-			output.push_back(0x80);
+		*data++ = (first || last) ? 0xc0 : 0x80;
 		
 		// CHUNK TYPE
 		// 0x02 - Frame samples entire frame
 		// 0x03 - Frame samples first fragment
 		// 0xC0 - Frame samples sequel fragment
-		if(fragmentsToSend==1)
-			output.push_back(0x02);
-		else if(i==0)
-			output.push_back(0x03);
-		else
-			output.push_back(0xc0);
+		if(numpackets==1) *data++ = 0x02;
+		else if(first) *data++ = 0x03;
+		else *data++ = 0xc0;
 		
 		// TIME STAMP
-		//ofGetSystemTime();
-		output.push_back((uint8_t) ((time+i) >> 24)) ;
-		output.push_back((uint8_t) ((time+i) >> 16)) ;
-		output.push_back((uint8_t) ((time+i) >> 8)) ;
-		output.push_back((uint8_t) (time+i)) ;
-		
-		
-		if(sendConfig) {
-			// CHANNEL CONFIG
-			// NUMBER OF CONFIG WORDS
-			output.push_back(0x04);
-			// SET ROUTING FLAG
-			output.push_back(0x01);
-			// ID (always 0);
-			output.push_back(0x00);
-			// DISCRETE GRAPHICS MODE
-			output.push_back(0x02);
-			
-			// CONF 1 X
-			output.push_back(0x42);
-			output.push_back(0x00);
-			
-			// 16 BIT PRECISION
-			output.push_back(0x40);
-			output.push_back(0x10);
-			
-			// CONF 2 Y
-			output.push_back(0x42);
-			output.push_back(0x10);
-			
-			// 16 BIT PRECISION
-			output.push_back(0x40);
-			output.push_back(0x10);
-			
-			// CONF 3 RED 638nm
-			output.push_back(0x52);
-			output.push_back(0x7e);
-			
-			// CONF 4 GREEN 532nm
-			output.push_back(0x52);
-			output.push_back(0x14);
-			
-			// CONF 5 BLUE
-			output.push_back(0x51);
-			output.push_back(0xcc);
-			
-			// Conf 6... blank zeros???
-			output.push_back(0x00);
-			output.push_back(0x00);
+		*data++ = (uint8_t)((time+i) >> 24);
+		*data++ = (uint8_t)((time+i) >> 16);
+		*data++ = (uint8_t)((time+i) >> 8);
+		*data++ = (uint8_t)(time+i);
 		
-			
+		if(first) {
+			// CHANNEL CONFIG :
+			// number of config words, routing flag, ID (always 0),
+			// discrete graphics mode, then the words - X and Y with
+			// 16 bit precision, red 638nm, green 532nm, blue, and a blank
+			static const uint8_t channelconfig[20] = {
+				0x04, 0x01, 0x00, 0x02,
+				0x42, 0x00, 0x40, 0x10,
+				0x42, 0x10, 0x40, 0x10,
+				0x52, 0x7e, 0x52, 0x14,
+				0x51, 0xcc, 0x00, 0x00 };
+			memcpy(data, channelconfig, sizeof(channelconfig));
+			data+=sizeof(channelconfig);
 			
 			// Data header
 			// Flags - if bit 1 is set then frame is played once, otherwise it repeats
-			output.push_back(0x01);
-			
-			// THIS IS WHAT SETS THE POINT SPEED ------------------------
-			// Then it's the frame duration in microseconds, should be number of points/point rate
-			int framemicros = (((uint64_t)(numPointsToSend - 1)) * 1000000ull) / (uint64_t)pps;
-			output.push_back((uint8_t) (framemicros >> 16));
-			output.push_back((uint8_t) (framemicros >> 8));
-			output.push_back((uint8_t) (framemicros));
+			*data++ = 0x01;
+			*data++ = (uint8_t)(framemicros >> 16);
+			*data++ = (uint8_t)(framemicros >> 8);
+			*data++ = (uint8_t)framemicros;
 		}
 		
-		//DATA START!
-		// now it's points! 7 bytes per point :
-		// XXYYRGB
-		int lastPoint = min(maxPointsPerFragment*(i+1), numPointsToSend);
-		for(; pointIndex<lastPoint ; pointIndex++) {
-			IDN_point &point = bufferedPoints[pointIndex];
-			point.getSerialised();
-			output.append(point.serialized, 7);
-			
+		int lastpoint = MIN(pointindex + (first ? firstpacketpoints : packetpoints), numpoints);
+		for(; pointindex<lastpoint; pointindex++) {
+			const IDN_point& point = points[pointindex];
+			*data++ = (uint8_t)(point.x >> 8);
+			*data++ = (uint8_t)point.x;
+			*data++ = (uint8_t)(point.y >> 8);
+			*data++ = (uint8_t)point.y;
+			*data++ = point.r;
+			*data++ = point.g;
+			*data++ = point.b;
 		}
 		
+		int packetsize = data - packet;
+		int messagesize = packetsize-4;
+		packet[4] = (uint8_t)(messagesize>>8);
+		packet[5] = (uint8_t)messagesize;
+		packetSizes[i] = packetsize;
 		
-		int messagesize = output.size()-4;
-		output[4] = (uint8_t)(messagesize>>8);
-		output[5] = (uint8_t)messagesize;
-		if(verbose) {
-			ofLog(OF_LOG_NOTICE, ofToString(messagesize));
-		
-			
-			//cout << hex << ((int)(counter>>8 ))  << " " << ((int)(uint8)(counter &0xff ))  << endl;
-			
-			
-			
-			//for (int i = 0; i<output.size() ; i++) {
-			for (int j = 0; j<12 ; j++) {
+		if(verbose) ofLog(OF_LOG_NOTICE, "DacIDN packet "+ofToString(i)+" : "+ofToString(packetsize)+" bytes");
+	}
+	
+	return numpackets;
+}
 
-				cout << hex << setfill('0') << setw(2) << (int)(uint8_t)(output[j]) << " ";
-				if((j<36) && (j%4==3)) cout <<endl;
-				else if((j>=36) && ((j-36)%7==6)) cout <<endl;
+void DacIDN :: sendPackets(int numpackets) {
+	
+	bool success = true;
+	
+#ifdef __linux__
+	// all the packets for the frame go in one system call
+	if(packetMessages.size()<numpackets) {
+		packetMessages.resize(numpackets);
+		packetVectors.resize(numpackets);
+	}
+	for(int i = 0; i<numpackets; i++) {
+		packetVectors[i].iov_base = packetBuffer.data() + i*maxPacketSize;
+		packetVectors[i].iov_len = packetSizes[i];
+		msghdr& message = packetMessages[i].msg_hdr;
+		memset(&message, 0, sizeof(message));
+		message.msg_iov = &packetVectors[i];
+		message.msg_iovlen = 1;
+	}
+	
+	int fd = udpConnection.getSocket();
+	int sent = 0;
+	while(sent<numpackets) {
+		int result = sendmmsg(fd, packetMessages.data()+sent, numpackets-sent, 0);
+		if(result<0) {
+			if(errno==EINTR) continue;
+			if(errno==EMSGSIZE) {
+				// the path MTU got smaller, the next frame will fit
+				if(!sendErrorLogged) ofLog(OF_LOG_NOTICE, "DacIDN - packets too big for the network");
+				sendErrorLogged = true;
+				updateMaxPacketSize(true);
+			} else if(!sendErrorLogged) {
+				ofLog(OF_LOG_WARNING, "DacIDN - send failed : "+string(strerror(errno)));
+				sendErrorLogged = true;
 			}
-		//		//cout << hex <<  ntohs(hello) << endl;
+			success = false;
+			break;
+		}
+		sent+=result;
+	}
+#else
+	for(int i = 0; i<numpackets; i++) {
+		if(udpConnection.Send((const char*)packetBuffer.data() + i*maxPacketSize, packetSizes[i])<0) {
+			if(!sendErrorLogged) ofLog(OF_LOG_WARNING, "DacIDN - send failed");
+			sendErrorLogged = true;
+			success = false;
+			break;
 		}
-		counter ++;
-		
-		udpConnection.Send(output.c_str(),output.length());
-		
-		if(verbose) ofLog(OF_LOG_NOTICE, ofToString(output.length()));
-		if(verbose) cout <<endl;
-		
-		
 	}
+#endif
 	
+	if(success) sendErrorLogged = false;
 }
 
 void DacIDN :: close() {
+	if(isThreadRunning()) {
+		stopThread();
+		// wake it up so it doesn't sit waiting for a frame
+		{
+			std::lock_guard<std::mutex> framelock(frameMutex);
+		}
+		frameCondition.notify_all();
+		waitForThread(false);
+	}
 	udpConnection.Close();
 }
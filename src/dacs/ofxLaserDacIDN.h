@@ -10,6 +10,17 @@
 #include "ofMain.h"
 #include "ofxLaserDacBase.h"
 #include "ofxNetwork.h"
+#include "TripleBuffer.h"
+#include "RingBuffer.h"
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#ifdef __linux__
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <errno.h>
+#endif
 
 #define IDN_MIN -32768
 #define IDN_MAX 32767
@@ -41,14 +52,37 @@ class IDN_point {
 	uint8_t b;
 };
 
+// gets at the socket so we can send all the packets for a frame at once
+class IDNUDPManager : public ofxUDPManager {
+	public :
+	decltype(m_hSocket) getSocket() { return m_hSocket; }
+};
+
+// how far from the end of the last frame each frame actually went out
+struct IDNJitterHistogram {
+	static const int numBins = 8;
+	// the top of each bin in microseconds, the last one has everything else
+	static constexpr int binEdges[numBins-1] = {25, 50, 100, 200, 500, 1000, 2000};
+	uint32_t counts[numBins] = {};
+	// frames that weren't ready when the last one finished, these aren't
+	// in the counts because it's the app's fault not ours
+	uint32_t lateFrames = 0;
+	
+	// the top of the bin that has this fraction of the frames in it or
+	// below, -1 if it's in the last bin
+	int getPercentileMicros(float fraction) const;
+};
 	
 class DacIDN : public DacBase, ofThread {
 	
 	public:
 	void setup(string ip);
 	
-	bool sendFrame(const vector<Point>& points);
-	bool sendPoints(const vector<Point>& points);
+	bool sendFrame(const PointBuffer& points);
+	bool sendPoints(const PointBuffer& points);
+	// anything that still sends vectors of Points
+	bool sendFrame(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendFrame(adapterBuffer); };
+	bool sendPoints(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendPoints(adapterBuffer); };
 	bool setPointsPerSecond(uint32_t pps);
 	
 	string getLabel(){
@@ -62,24 +96,111 @@ class DacIDN : public DacBase, ofThread {
 	
 	void close();
 	
+	bool isFrameWaiting() { return frameBuffers.hasNewFrame(); };
+	
+	const vector<ofAbstractParameter*>& getDisplayData();
+	void resetDisplayData();
+	IDNJitterHistogram getJitterHistogram();
+	
+	// the largest packet the network can take without splitting it up,
+	// including the IP and UDP headers. 0 (the default) asks the network
+	// on linux and uses 1500 everywhere else. Set it to 9000 or so if
+	// you've got jumbo frames all the way to the DAC.
+	void setMTU(int newmtu) { mtu = newmtu; };
+	
+	// for sendPoints, which streams the points to the DAC in a continuous
+	// wave rather than as frames. The latency is how far ahead of the
+	// DAC we keep it (the points it has buffered), and if the app gives
+	// us more than maxQueueMillis worth of points the oldest are skipped.
+	void setWaveLatency(float millis) { waveLatencyMillis = MAX(millis, 1); };
+	void setWaveMaxQueue(float millis) { waveMaxQueueMillis = MAX(millis, 1); };
+	
+	ofParameter<string> jitterDisplay;
+	ofParameter<string> lateFramesDisplay;
+	ofParameter<int> pointBufferDisplay;
+	ofParameter<string> waveDisplay;
+	
 	protected:
 
 	private:
 
 	void threadedFunction();
 	
+	// waits for the current frame to finish and sends the next one
+	void playFrame();
+	// sends as much of the wave as we need to stay waveLatencyMillis
+	// ahead, then waits until we need to send more
+	void playWave();
+	// puts a chunk of the wave into the packet buffer and returns how
+	// long it lasts in microseconds
+	uint32_t buildWaveChunk(int packetindex, int numpoints, uint32_t rate, bool sendconfig);
+	void convertPoint(const PointBuffer& points, int i, IDN_point& p);
+	
 	void sendFrameToDac();
+	// splits the frame into packets no bigger than maxPacketSize and
+	// returns how many there are
+	int buildPackets(const vector<IDN_point>& points);
+	void sendPackets(int numpackets);
+	// toobig is when a send failed because the packets were too big,
+	// then we ask the network even if we were given an MTU
+	void updateMaxPacketSize(bool toobig = false);
 
-	ofxUDPManager udpConnection;
+	IDNUDPManager udpConnection;
+	
+	std::atomic<int> mtu{0};
+	// the mtu that maxPacketSize was worked out from
+	int currentMtu = -1;
+	// the most UDP payload we can send in one go
+	int maxPacketSize = 1472;
+	// the packets for a frame are built in here, one every maxPacketSize
+	// bytes. It only grows, so there's no allocating once it's big enough.
+	vector<uint8_t> packetBuffer;
+	vector<int> packetSizes;
+#ifdef __linux__
+	vector<mmsghdr> packetMessages;
+	vector<iovec> packetVectors;
+#endif
+	bool sendErrorLogged = false;
 
-	uint32_t pps;
+	std::atomic<uint32_t> pps;
 	bool connected;
-	bool newFrameIsBuffered;
-	uint64_t lastFrameTime;
-	uint64_t lastFrameDuration;
 	
-	vector<IDN_point> pointsToSend;
-	deque<IDN_point> bufferedPoints;
+	// frames from sendFrame, the thread sends the latest one
+	TripleBuffer<vector<IDN_point>> frameBuffers;
+	// sendFrame wakes the thread up with this when there's a new frame,
+	// the mutex is only for the condition variable, the frames don't need it
+	std::mutex frameMutex;
+	std::condition_variable frameCondition;
+	// when the frame that's playing now finishes, from the monotonic clock
+	// so it isn't affected by changes to the system time
+	std::chrono::steady_clock::time_point frameEndTime;
+	
+	// false when we're streaming points from sendPoints
+	std::atomic<bool> frameMode{true};
+	bool firstFrame = true;
+	
+	// points from sendPoints, waiting to go out in the wave
+	RingBuffer<IDN_point> waveBuffer;
+	// when the last bit of the wave we sent finishes playing
+	std::chrono::steady_clock::time_point waveEndTime;
+	std::chrono::steady_clock::time_point waveConfigTime;
+	bool waveStarted = false;
+	bool waveStarving = false;
+	IDN_point lastWavePoint;
+	std::atomic<float> waveLatencyMillis{4};
+	std::atomic<float> waveMaxQueueMillis{50};
+	// how long each wave chunk is
+	const int waveChunkMicros = 2000;
+	// times we had to pad with blank points because the app hadn't
+	// given us enough, points we skipped because it gave us too many,
+	// and times the thread got so far behind the DAC ran out
+	std::atomic<int> waveStarvedCount{0};
+	std::atomic<int> waveDroppedCount{0};
+	std::atomic<int> waveLateCount{0};
+	
+	// filled in by the DAC thread, only touched with histogramMutex
+	IDNJitterHistogram jitterHistogram;
+	std::mutex histogramMutex;
 	uint16_t counter ;
 
 	const bool verbose = false; 
@@ -28,6 +28,7 @@ using namespace ofxLaser;
 DacLaserdock:: ~DacLaserdock() {
 	stopThread();
 	waitForThread(); 
+	registry.closeDevice(device);
 	
 }
 
@@ -35,34 +36,67 @@ DacLaserdock:: ~DacLaserdock() {
 void DacLaserdock::setup(string serial) {
 	
 	serialNumber = serial;
+	bufferedPoints.setCapacity(1<<17);
 	
 	connectToDevice(serial);
 
 	pointBufferDisplay.set("Point Buffer", 0,0,1799);
+	bufferTargetDisplay.set("Buffer Target", 0,0,1799);
+	underflowDisplay.set("Underflows", 0,0,1000);
+	playbackDisplay.set("Playback", "Streaming");
 	displayData.push_back(&serialNumber);
 	displayData.push_back(&pointBufferDisplay);
+	displayData.push_back(&bufferTargetDisplay);
+	displayData.push_back(&underflowDisplay);
+	displayData.push_back(&playbackDisplay);
 	
 	startThread();
 
 }
 
 
+const vector<ofAbstractParameter*>& DacLaserdock :: getDisplayData() {
+	
+	// the DAC thread only writes the atomics, the parameters get
+	// changed here on the app thread
+	int capacity = MAX(deviceCapacityDisplay.load(), 1);
+	pointBufferDisplay.setMax(capacity);
+	pointBufferDisplay = deviceFillDisplay.load();
+	bufferTargetDisplay.setMax(capacity);
+	bufferTargetDisplay = fillTargetDisplay.load();
+	int underflows = underflowCount;
+	underflowDisplay.setMax(MAX(underflowDisplay.getMax(), underflows));
+	underflowDisplay = underflows;
+	switch(runnerStateDisplay) {
+		case RUNNER_UPLOADING :
+			playbackDisplay = "Uploading frame";
+			break;
+		case RUNNER_DRAINING :
+			playbackDisplay = "Starting loop";
+			break;
+		case RUNNER_PLAYING :
+			playbackDisplay = "Looping on DAC";
+			break;
+		default :
+			playbackDisplay = "Streaming";
+	}
+	return displayData;
+}
+
+void DacLaserdock :: resetDisplayData() {
+	underflowCount = 0;
+}
+
 bool DacLaserdock::connectToDevice(string serial) {
 	
-	std::vector<std::unique_ptr<LaserdockDevice> > devices = lddmanager.get_laserdock_devices();
-	LaserdockDevice* newdevice = nullptr;
-	if(devices.size()==0) {
-		
-	} else if(serial == "") {
-		newdevice = devices[0].release();
-	} else {
-		for(int i = 0; i<devices.size(); i++) {
-			if(devices[i]->serial_number() == serial) {
-				newdevice = devices[i].release();
-				break;
-			}
-		}
+	// make sure the device is released if we already have one, the
+	// registry won't give it to us again while it's open
+	if(device!=nullptr) {
+		registry.closeDevice(device);
+		device = nullptr;
 	}
+	
+	LaserdockDevice* newdevice = registry.openDevice(serial);
 	if(newdevice == nullptr) {
 		//ofLogNotice("DacLaserdock : couldn't connect to DAC " + ofToString(serial));
 		
@@ -70,12 +104,11 @@ bool DacLaserdock::connectToDevice(string serial) {
 	}
 	
 	// NEW DEVICE ACQUIRED!
-	if(device!=nullptr) {
-		// make sure device is released if we already have one
-		delete device;
-	}
-	
 	device = newdevice;
+	// the samples don't go through LaserdockDevice::send, so we do its
+	// flipping ourselves when we convert the points
+	flipX = device->flixpX();
+	flipY = device->flixpY();
 	
 	connected = true;
 	
@@ -125,6 +158,8 @@ bool DacLaserdock::connectToDevice(string serial) {
 	LaserdockSample * samples = (LaserdockSample*) calloc(sizeof(LaserdockSample), 7);
 	memset(samples, 0xFF, sizeof(LaserdockSample) * 7);
 	d.runner_mode_load(samples, 0, 7);
+	// they're in the runner memory now too
+	runnerSamplesLoaded = MAX(runnerSamplesLoaded, 7);
 
 	serialNumber.setName("Serial");
 	serialNumber.set(device->serial_number());
@@ -135,89 +170,63 @@ bool DacLaserdock::connectToDevice(string serial) {
 	return true;
 }
 
-bool DacLaserdock:: sendFrame(const vector<Point>& points){
+bool DacLaserdock:: sendFrame(const PointBuffer& points){
 	if(!connected) return false;
 	
-	//	ofLog(OF_LOG_NOTICE, "point create count  : " + ofToString(dac_point::createCount));
-	//	ofLog(OF_LOG_NOTICE, "point destroy count : " + ofToString(dac_point::destroyCount));
+	// fill the spare frame buffer without locking, the DAC thread picks
+	// up the latest one next time it runs out of points
+	vector<LaserdockSample>& frame = frameBuffers.getWriteBuffer();
+	frame.resize(points.size());
 	
-	int maxBufferSize = 1000;
-	LaserdockSample& p1 = sendpoint;
-	// if we already have too many points in the buffer,
-	// then it means that we need to skip this frame
-	
-	if(isReplaying || (bufferedPoints.size()<maxBufferSize)) {
+	LaserdockSample p1;
+	bool flipx = flipX;
+	bool flipy = flipY;
+	for(int i = 0; i<points.size(); i++) {
 		
-		framePoints.resize(points.size());
+		p1.x = ofMap(points.x[i],0,800, LASERDOCK_MIN, LASERDOCK_MAX);
+		p1.y = ofMap(points.y[i],800,0, LASERDOCK_MIN, LASERDOCK_MAX); // Y is UP
+		if(flipx) p1.x = LASERDOCK_MAX-p1.x;
+		if(flipy) p1.y = LASERDOCK_MAX-p1.y;
+		p1.rg = (int)roundf(points.r[i]) | ((int)roundf(points.g[i])<<8);
+		p1.b = roundf(points.b[i]);
 		
-		if(lock()) {
-			frameMode = true;
-			for(int i = 0; i<points.size(); i++) {
-				
-				const Point& p2 = points[i];
-				p1.x = ofMap(p2.x,0,800, LASERDOCK_MIN, LASERDOCK_MAX);
-				p1.y = ofMap(p2.y,800,0, LASERDOCK_MIN, LASERDOCK_MAX); // Y is UP
-				p1.rg = (int)roundf(p2.r) | ((int)roundf(p2.g)<<8);
-				p1.b = roundf(p2.b);
-				addPoint(p1);
-				
-				framePoints[i] = p1;
-			}
-			isReplaying = false;
-			unlock();
-		}
-		return true;
-	} else {
-		// we've skipped this frame... TODO - dropped frame count?
-		return false;
+		frame[i] = p1;
 	}
-}
-
-inline bool DacLaserdock :: addPoint(const LaserdockSample &point ){
-	LaserdockSample* p = getLaserdockSample();
-	*p = point; // copy assignment hopefully!
-	bufferedPoints.push_back(p);
+	
+	frameMode = true;
+	frameBuffers.publish();
 	return true;
 }
 
-
-LaserdockSample*  DacLaserdock :: getLaserdockSample() {
-	LaserdockSample* p;
-	if(sparePoints.size()==0) {
-		p= new LaserdockSample();
-	} else {
-		p = sparePoints.back();
-		sparePoints.pop_back();
-	}
-	
-	p->x =
-	p->y =
-	p->rg =
-	p->b = 0;
-	
-	return p;
+inline bool DacLaserdock :: addPoint(const LaserdockSample &point ){
+	return bufferedPoints.push(point);
 }
 
 
-bool DacLaserdock::sendPoints(const vector<Point>& points) {
+bool DacLaserdock::sendPoints(const PointBuffer& points) {
 	if(bufferedPoints.size()>pps*0.5) {
 		return false;
 	}
-	frameMode = false; 
-	LaserdockSample p1;
-	if(lock()) {
+	if(frameMode) {
+		// the DAC thread only adds frames while it has the lock, so once
+		// we've switched it off in here it'll never add another one
+		while(!lock()) {}
 		frameMode = false;
-
-		for(int i = 0; i<points.size(); i++) {
-			const Point& p2 = points[i];
-			p1.x = ofMap(p2.x,0,800, LASERDOCK_MIN, LASERDOCK_MAX);
-			p1.y = ofMap(p2.y,800,0, LASERDOCK_MIN, LASERDOCK_MAX); // Y is UP in ilda specs
-			p1.rg = (int)roundf(p2.r) | ((int)roundf(p2.g)<<8);
-			p1.b = roundf(p2.b);
-			addPoint(p1);
-		}
 		unlock();
 	}
+	
+	LaserdockSample p1;
+	bool flipx = flipX;
+	bool flipy = flipY;
+	for(int i = 0; i<points.size(); i++) {
+		p1.x = ofMap(points.x[i],0,800, LASERDOCK_MIN, LASERDOCK_MAX);
+		p1.y = ofMap(points.y[i],800,0, LASERDOCK_MIN, LASERDOCK_MAX); // Y is UP in ilda specs
+		if(flipx) p1.x = LASERDOCK_MAX-p1.x;
+		if(flipy) p1.y = LASERDOCK_MAX-p1.y;
+		p1.rg = (int)roundf(points.r[i]) | ((int)roundf(points.g[i])<<8);
+		p1.b = roundf(points.b[i]);
+		addPoint(p1);
+	}
 	return true;
 };
 
@@ -233,74 +242,364 @@ bool DacLaserdock::setPointsPerSecond(uint32_t newpps) {
 
 void DacLaserdock :: threadedFunction(){
 	
-	const uint32_t samples_per_packet = 64;
-	const uint32_t circle_steps = 300;
-	LaserdockSample * samples = (LaserdockSample *)calloc(sizeof(LaserdockSample), samples_per_packet);
-		
-	int _index = 0;
-	
 	while(isThreadRunning()) {
-	
-		int count = samples_per_packet;
-
-		
 		
-		while(!lock()){};
-
-		// if we're out of points, let's replay the frame!
-		if(bufferedPoints.size()<samples_per_packet) {
-			if(frameMode && replayFrames) {
-				for(int i = 0; i<framePoints.size(); i++) {
-					addPoint(framePoints[i]);
-				}
-				isReplaying = true;
+		if(!connected) {
+			// try to reconnect, but only if a Laserdock has been plugged
+			// in since we last tried, otherwise wait for one
+			cancelTransfers();
+			uint32_t arrivals = registry.getArrivalCount();
+			if((arrivals==lastArrivalCount) && (ofGetElapsedTimeMillis()-lastConnectAttemptMillis<reconnectIntervalMillis)) {
+				registry.waitForArrival(lastArrivalCount, 500);
+				continue;
 			}
+			lastArrivalCount = arrivals;
+			lastConnectAttemptMillis = ofGetElapsedTimeMillis();
+			if(lock()){
+				if(!connectToDevice(serialNumber)) {
+					unlock();
+					continue;
+				} else {
+					unlock();
+				}
+			};
+			setupTransfers();
+			// it's not looping anything now, whatever it was doing before
+			runnerState = RUNNER_OFF;
+			runnerStateDisplay = RUNNER_OFF;
+			runnerFailed = false;
 		}
+		if(!transfersAllocated) setupTransfers();
 		
-		LaserdockSample& p = sendpoint;
-		for(int i = 0; i<samples_per_packet; i++) {
-
-			if(bufferedPoints.size()>0) {
-				p = *bufferedPoints[0];
-				sparePoints.push_back(bufferedPoints[0]);
-				bufferedPoints.pop_front();
-				lastpoint = p;
-			} else {
-				p = lastpoint;
-				p.rg = p.b =0;
-				
-			}
-			samples[i] = p;
-		}
-		if(connected && (newPPS!=pps)) {
+		if(newPPS!=pps) {
+			while(!lock()){};
 			pps = newPPS;
+			unlock();
 			device->set_dac_rate(pps);
 		}
-		unlock();
-
-		if(connected) {
-			if(!device->send_samples(samples,samples_per_packet)){
-				ofLog(OF_LOG_NOTICE, "send_samples failed");
-				setConnected(false);
-			} else {
-				setConnected(true);
+		
+		// the runner only works with frames
+		if((runnerState!=RUNNER_OFF) && (!frameMode || !runnerModeEnabled)) stopRunner();
+		
+		// if we're out of points, send the latest frame, or replay
+		// the last one if there isn't a new one yet. Once we've stopped
+		// streaming for the runner we still need to know when there's a
+		// new frame, so we check every time.
+		bool streaming = (runnerState==RUNNER_OFF) || (runnerState==RUNNER_UPLOADING);
+		if(frameMode && (!streaming || (bufferedPoints.getAvailable()<samplesPerTransfer))) {
+			while(!lock()){};
+			// sendPoints might have switched frame mode off while we were waiting
+			if(frameMode) {
+				bool newframe = frameBuffers.update();
+				vector<LaserdockSample>& framePoints = frameBuffers.getReadBuffer();
+				if(newframe) checkFrameForRunner(framePoints);
+				// (that might have stopped the runner)
+				streaming = (runnerState==RUNNER_OFF) || (runnerState==RUNNER_UPLOADING);
+				if(streaming && (bufferedPoints.getAvailable()<samplesPerTransfer) && (newframe || replayFrames)) {
+					bufferedPoints.push(framePoints.data(), framePoints.size());
+				}
+			}
+			unlock();
+		}
+		
+		if(frameMode && runnerModeEnabled) {
+			// start uploading once the frame's been the same for long enough
+			if((runnerState==RUNNER_OFF) && !runnerFailed && !runnerFrame.empty() && (runnerFrame.size()<=maxRunnerSamples) && (ofGetElapsedTimeMicros()-frameUnchangedMicros > runnerModeDelayMillis*1000)) {
+				runnerState = RUNNER_UPLOADING;
+				runnerUploadPosition = 0;
+				runnerUploadSize = MAX((int)runnerFrame.size(), runnerSamplesLoaded);
+			}
+			if(runnerState==RUNNER_UPLOADING) {
+				if(!uploadRunnerFrame()) {
+					runnerModeFailed();
+				} else if(runnerUploadPosition>=runnerUploadSize) {
+					// the points we've got left finish at the end of a frame,
+					// so let them run out before we start the loop. The DAC
+					// stays on the last point it played until the runner
+					// starts, so finish with that point blanked.
+					LaserdockSample blank = runnerFrame.back();
+					blank.rg = blank.b = 0;
+					for(int i = 0; i<runnerBlankSamples; i++) bufferedPoints.push(blank);
+					runnerState = RUNNER_DRAINING;
+				}
+			}
+			if((runnerState==RUNNER_DRAINING) && (bufferedPoints.getAvailable()==0) && (transfersInFlight==0) && (ofGetElapsedTimeMicros()-lastSpaceCheckMicros>=500)) {
+				if(!updateDeviceSpace()) {
+					transferFailed = true;
+				} else if(deviceEmpty) {
+					startRunner();
+				}
 			}
+			runnerStateDisplay = runnerState;
+		}
+		
+		if((runnerState==RUNNER_DRAINING) || (runnerState==RUNNER_PLAYING)) {
+			// we're not streaming, but we still want new frames at the
+			// frame rate so we can tell when they change
+			setFrameNeededTime(ofGetElapsedTimeMicros() + (uint64_t)runnerFrame.size()*1000000ull/MAX(pps, 1));
+		} else if(frameMode && (pps>0)) {
+			// the next frame goes in when we're down to less than a transfer
+			int pointsleft = (int)bufferedPoints.getAvailable() - samplesPerTransfer;
+			setFrameNeededTime(ofGetElapsedTimeMicros() + (uint64_t)MAX(pointsleft, 0)*1000000ull/pps);
 		} else {
-			// try to reconnect!
-			if(lock()){
-				if(!connectToDevice(serialNumber)) {
-					unlock();
-					// wait half a second?
-					sleep(500);
-				} else {
-					unlock();
+			setFrameNeededTime(0);
+		}
+		
+		// keep the DAC's buffer topped up to the fill target. deviceSpace
+		// is what's free once everything we've sent has got there, so
+		// capacity - deviceSpace is what'll be in it.
+		int filltarget = getFillTarget();
+		for(LaserdockTransfer& transfer : transfers) {
+			if(runnerState==RUNNER_PLAYING) break;
+			if(transfer.inFlight) continue;
+			if(deviceCapacity-deviceSpace+samplesPerTransfer > filltarget) {
+				// it's a round trip to the DAC to ask how much room it has,
+				// so only do it once it's had time to play a transfer
+				uint64_t transfermicros = (uint64_t)samplesPerTransfer*1000000ull/MAX(pps, 1);
+				if(ofGetElapsedTimeMicros()-lastSpaceCheckMicros < MAX(transfermicros, 500)) break;
+				if(!updateDeviceSpace()) {
+					transferFailed = true;
+					break;
 				}
-			};
-			
+				if(deviceCapacity-deviceSpace+samplesPerTransfer > filltarget) break;
+			}
+			if(!submitTransfer(transfer)) break;
+		}
+		
+		// wait for transfers to finish (the callbacks happen in here),
+		// or for a bit if there aren't any
+		struct timeval timeout = {0, 1000};
+		libusb_handle_events_timeout_completed(NULL, &timeout, NULL);
+		
+		if(transferFailed) {
+			ofLog(OF_LOG_NOTICE, "DacLaserdock - sending samples failed");
+			cancelTransfers();
+			setConnected(false);
+		}
+	}
+	
+	// don't leave it looping the last frame on its own
+	if(connected && (runnerState!=RUNNER_OFF)) stopRunner();
+	cancelTransfers();
+	freeTransfers();
+}
+
+void DacLaserdock :: setupTransfers() {
+	
+	// we send a couple of the DAC's bulk packets in each transfer
+	uint32_t packetsamples = 0;
+	if(!device->bulk_packet_sample_count(&packetsamples) || (packetsamples==0)) packetsamples = 32;
+	samplesPerTransfer = packetsamples*2;
+	
+	uint32_t capacity = 0;
+	if(!device->ringbuffer_sample_count(&capacity) || (capacity==0)) capacity = 1799;
+	deviceCapacity = capacity;
+	
+	if(!transfersAllocated) {
+		for(LaserdockTransfer& transfer : transfers) {
+			transfer.transfer = libusb_alloc_transfer(0);
+			transfer.dac = this;
+		}
+		transfersAllocated = true;
+	}
+	for(LaserdockTransfer& transfer : transfers) {
+		transfer.samples.resize(samplesPerTransfer);
+	}
+	transfersInFlight = 0;
+	samplesInFlight = 0;
+	transferFailed = false;
+	deviceSpace = 0;
+	lastSpaceCheckMicros = 0;
+	deviceEmpty = false;
+	devicePlaying = false;
+	deviceCapacityDisplay = MAX(deviceCapacity, 1);
+}
+
+int DacLaserdock :: getFillTarget() {
+	
+	// we always need enough for the transfers on their way plus the
+	// blank ones that keep it going, but never more than it holds
+	int target = (int)(pps*targetLatencyMillis/1000.0f);
+	target = MAX(target, samplesPerTransfer*3);
+	if(deviceCapacity>0) target = MIN(target, deviceCapacity);
+	fillTargetDisplay = target;
+	return target;
+}
+
+bool DacLaserdock :: submitTransfer(LaserdockTransfer& transfer) {
+	
+	int count = bufferedPoints.pop(transfer.samples.data(), samplesPerTransfer);
+	if(count>0) {
+		lastpoint = transfer.samples[count-1];
+	} else {
+		// we've got nothing to send. If the DAC's about to run out then
+		// keep it going with blank points where we are, otherwise wait
+		// for some more to turn up. (Unless we're letting it run out to
+		// start the runner.)
+		if((runnerState!=RUNNER_OFF) && (runnerState!=RUNNER_UPLOADING)) return false;
+		if(deviceCapacity-deviceSpace > samplesPerTransfer*2) return false;
+		LaserdockSample blank = lastpoint;
+		blank.rg = blank.b = 0;
+		count = samplesPerTransfer;
+		for(int i = 0; i<count; i++) transfer.samples[i] = blank;
+	}
+	
+	libusb_fill_bulk_transfer(transfer.transfer, device->data_handle(), (3 | LIBUSB_ENDPOINT_OUT), (unsigned char*)transfer.samples.data(), count*sizeof(LaserdockSample), &DacLaserdock::transferComplete, &transfer, 1000);
+	
+	// it could finish on another thread before submit returns, so it
+	// has to be marked as on its way first
+	transfer.inFlight = true;
+	transfer.numSamples = count;
+	transfersInFlight++;
+	samplesInFlight+=count;
+	if(libusb_submit_transfer(transfer.transfer)!=0) {
+		transfer.inFlight = false;
+		transfersInFlight--;
+		samplesInFlight-=count;
+		transferFailed = true;
+		return false;
+	}
+	deviceSpace-=count;
+	return true;
+}
+
+void LIBUSB_CALL DacLaserdock :: transferComplete(libusb_transfer* usbtransfer) {
+	
+	LaserdockTransfer& transfer = *(LaserdockTransfer*)usbtransfer->user_data;
+	DacLaserdock& dac = *transfer.dac;
+	
+	transfer.inFlight = false;
+	dac.transfersInFlight--;
+	dac.samplesInFlight-=transfer.numSamples;
+	
+	if((usbtransfer->status!=LIBUSB_TRANSFER_COMPLETED) && (usbtransfer->status!=LIBUSB_TRANSFER_CANCELLED)) {
+		dac.transferFailed = true;
+	}
+}
+
+bool DacLaserdock :: updateDeviceSpace() {
+	
+	// anything that's still on its way when we ask won't be in the
+	// count, so take it off. (Some of it might get there while we're
+	// asking, that just means we're a little cautious.)
+	int inflight = samplesInFlight;
+	uint32_t empty = 0;
+	if(!device->ringbuffer_empty_sample_count(&empty)) return false;
+	deviceSpace = (int)empty - inflight;
+	lastSpaceCheckMicros = ofGetElapsedTimeMicros();
+	
+	int fill = MAX(deviceCapacity-(int)empty, 0);
+	deviceFillDisplay = fill;
+	// if it's completely empty after it's started playing then it's
+	// run out, and the laser's been sitting still
+	if(fill==0) {
+		if(devicePlaying && !deviceEmpty && (runnerState!=RUNNER_DRAINING)) {
+			underflowCount++;
+			ofLogVerbose("DacLaserdock - buffer underflow");
 		}
+		deviceEmpty = true;
+	} else {
+		deviceEmpty = false;
+		devicePlaying = true;
 	}
+	return true;
+}
+
+void DacLaserdock :: checkFrameForRunner(const vector<LaserdockSample>& frame) {
+	
+	if(!runnerModeEnabled) return;
+	bool changed = (frame.size()!=runnerFrame.size()) || (memcmp(frame.data(), runnerFrame.data(), frame.size()*sizeof(LaserdockSample))!=0);
+	if(!changed) return;
 	
-	free(samples);
+	runnerFrame = frame;
+	frameUnchangedMicros = ofGetElapsedTimeMicros();
+	if(runnerState!=RUNNER_OFF) stopRunner();
+}
+
+bool DacLaserdock :: uploadRunnerFrame() {
+	
+	// each load is a round trip to the DAC, so just do a millisecond's
+	// worth at a time and carry on streaming in between
+	uint64_t starttime = ofGetElapsedTimeMicros();
+	int framesize = runnerFrame.size();
+	// anything after the end of the frame is padding, to blank out
+	// the rest of a longer frame we loaded before
+	LaserdockSample blank = runnerFrame.back();
+	blank.rg = blank.b = 0;
+	LaserdockSample samples[runnerSamplesPerLoad];
+	
+	while((runnerUploadPosition<runnerUploadSize) && (ofGetElapsedTimeMicros()-starttime<1000)) {
+		int count = MIN(runnerSamplesPerLoad, runnerUploadSize-runnerUploadPosition);
+		for(int i = 0; i<count; i++) {
+			int index = runnerUploadPosition+i;
+			samples[i] = (index<framesize) ? runnerFrame[index] : blank;
+		}
+		if(!device->runner_mode_load(samples, runnerUploadPosition, count)) {
+			return false;
+		}
+		runnerUploadPosition+=count;
+		runnerSamplesLoaded = MAX(runnerSamplesLoaded, runnerUploadPosition);
+	}
+	return true;
+}
+
+void DacLaserdock :: startRunner() {
+	
+	if(!device->runner_mode_enable(true) || !device->runner_mode_run(true)) {
+		runnerModeFailed();
+		return;
+	}
+	runnerState = RUNNER_PLAYING;
+	devicePlaying = false;
+}
+
+void DacLaserdock :: stopRunner() {
+	
+	if(runnerState==RUNNER_PLAYING) {
+		device->runner_mode_run(false);
+		device->runner_mode_enable(false);
+	}
+	runnerState = RUNNER_OFF;
+	runnerStateDisplay = RUNNER_OFF;
+	// the buffer's empty, that's not an underflow
+	devicePlaying = false;
+	// and wait again before we upload
+	frameUnchangedMicros = ofGetElapsedTimeMicros();
+}
+
+void DacLaserdock :: runnerModeFailed() {
+	
+	// it might be older firmware, just carry on streaming until we
+	// reconnect rather than trying again every frame
+	ofLogWarning("DacLaserdock - runner mode didn't work, streaming instead");
+	runnerFailed = true;
+	device->runner_mode_run(false);
+	device->runner_mode_enable(false);
+	runnerState = RUNNER_OFF;
+	runnerStateDisplay = RUNNER_OFF;
+}
+
+void DacLaserdock :: cancelTransfers() {
+	
+	if(transfersInFlight==0) return;
+	for(LaserdockTransfer& transfer : transfers) {
+		if(transfer.inFlight) libusb_cancel_transfer(transfer.transfer);
+	}
+	// the callbacks still have to happen before we can reuse them, give
+	// up after a second if the device has gone really wrong
+	uint64_t starttime = ofGetElapsedTimeMicros();
+	while((transfersInFlight>0) && (ofGetElapsedTimeMicros()-starttime<1000000)) {
+		struct timeval timeout = {0, 10000};
+		libusb_handle_events_timeout_completed(NULL, &timeout, NULL);
+	}
+}
+
+void DacLaserdock :: freeTransfers() {
+	for(LaserdockTransfer& transfer : transfers) {
+		if(!transfer.inFlight) libusb_free_transfer(transfer.transfer);
+		transfer.transfer = nullptr;
+	}
+	transfersAllocated = false;
 }
 
 
@@ -11,9 +11,11 @@
 #include "ofMain.h"
 #include "ofxLaserDacBase.h"
 #include "ofxNetwork.h"
-#include "LaserdockDeviceManager.h"
 #include "LaserdockDevice.h"
+#include "ofxLaserLaserdockRegistry.h"
 #include "libusb.h"
+#include "TripleBuffer.h"
+#include "RingBuffer.h"
 
 
 #define LASERDOCK_MIN 0
@@ -24,15 +26,19 @@ namespace ofxLaser {
 class DacLaserdock : public DacBase, ofThread{
 	public:
 	
-	DacLaserdock() : lddmanager(LaserdockDeviceManager::getInstance()) {};
+	DacLaserdock() : registry(LaserdockRegistry::getInstance()) {};
 	~DacLaserdock();
 	
 	void setup(string serial="");
 	bool connectToDevice(string serial="");
 	
-	bool sendFrame(const vector<Point>& points) ;
-	bool sendPoints(const vector<Point>& points) ;
+	bool sendFrame(const PointBuffer& points);
+	bool sendPoints(const PointBuffer& points);
+	// anything that still sends vectors of Points
+	bool sendFrame(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendFrame(adapterBuffer); };
+	bool sendPoints(const vector<Point>& points) { adapterBuffer.copyFrom(points); return sendPoints(adapterBuffer); };
 	bool setPointsPerSecond(uint32_t pps);
+	bool isFrameWaiting() { return frameBuffers.hasNewFrame(); };
 	
 	string getLabel(){return "Laserdock";};
 	
@@ -42,10 +48,30 @@ class DacLaserdock : public DacBase, ofThread{
 	}
 	
 	bool addPoint(const LaserdockSample &point );
-	// simple object pooling system
-	LaserdockSample* getLaserdockSample();
+	
+	// how much time's worth of samples to keep in the Laserdock's buffer.
+	// Less means frame changes get to the laser sooner, but too little
+	// and it'll run out. Can be called from any thread.
+	void setTargetLatency(float millis) { targetLatencyMillis = MAX(millis, 1); };
+	float getTargetLatency() { return targetLatencyMillis; };
+	
+	// if the frame doesn't change for a while, upload it to the
+	// Laserdock and let it loop it by itself ("runner mode") until it
+	// does. Saves USB bandwidth and CPU, and it keeps going if the app
+	// stalls. Only works with sendFrame, and frames up to
+	// maxRunnerSamples long.
+	void setRunnerModeEnabled(bool enabled) { runnerModeEnabled = enabled; };
+	bool getRunnerModeEnabled() { return runnerModeEnabled; };
+	// how long the frame has to stay the same before we upload it
+	void setRunnerModeDelay(float millis) { runnerModeDelayMillis = MAX(millis, 0); };
+	
+	const vector<ofAbstractParameter*>& getDisplayData();
+	void resetDisplayData();
 	
 	ofParameter<int> pointBufferDisplay;
+	ofParameter<int> bufferTargetDisplay;
+	ofParameter<int> underflowDisplay;
+	ofParameter<string> playbackDisplay;
 	ofParameter<string> serialNumber; 
 	//	ofParameter<int> latencyDisplay;
 //	ofParameter<int> reconnectCount;
@@ -55,19 +81,122 @@ class DacLaserdock : public DacBase, ofThread{
 
 	void setConnected(bool state);
 	
-	LaserdockDeviceManager &lddmanager;
+	// The samples go to the DAC in asynchronous libusb transfers, with
+	// up to numTransfers of them on their way at once, so there's no gap
+	// while we wait for one to finish before sending the next. They're
+	// sent from the DAC thread, but libusb calls transferComplete from
+	// whichever thread is handling events (it could be another
+	// Laserdock's), so the things it changes are atomic.
+	struct LaserdockTransfer {
+		libusb_transfer* transfer = nullptr;
+		vector<LaserdockSample> samples;
+		int numSamples = 0;
+		std::atomic<bool> inFlight{false};
+		DacLaserdock* dac = nullptr;
+	};
+	static void LIBUSB_CALL transferComplete(libusb_transfer* transfer);
+	void setupTransfers();
+	// cancels anything still on its way and waits for it
+	void cancelTransfers();
+	void freeTransfers();
+	// fills up the transfer from bufferedPoints and sends it, returns
+	// false if there wasn't anything to send
+	bool submitTransfer(LaserdockTransfer& transfer);
+	// asks the DAC how much room it has in its buffer
+	bool updateDeviceSpace();
+	// how many samples we want in the DAC's buffer, from the latency
+	int getFillTarget();
+	
+	static const int numTransfers = 4;
+	LaserdockTransfer transfers[numTransfers];
+	bool transfersAllocated = false;
+	int samplesPerTransfer = 64;
+	std::atomic<int> transfersInFlight{0};
+	std::atomic<int> samplesInFlight{0};
+	std::atomic<bool> transferFailed{false};
+	// the size of the DAC's buffer, and how much of it is free once
+	// the samples we've sent since we last asked have got there
+	int deviceCapacity = 0;
+	int deviceSpace = 0;
+	uint64_t lastSpaceCheckMicros = 0;
+	// so we only count each time it runs dry once
+	bool deviceEmpty = false;
+	bool devicePlaying = false;
+	
+	// RUNNER MODE
+	// While the frame's uploading we carry on streaming it, then we let
+	// the buffer run out at the end of a frame, so the runner starts
+	// where the stream left off.
+	enum RunnerState {
+		RUNNER_OFF,
+		RUNNER_UPLOADING,
+		RUNNER_DRAINING,
+		RUNNER_PLAYING
+	};
+	// call with every new frame, starts or stops the runner depending
+	// on whether it's changed
+	void checkFrameForRunner(const vector<LaserdockSample>& frame);
+	// uploads a bit more of the frame, returns false if it failed
+	bool uploadRunnerFrame();
+	void startRunner();
+	void stopRunner();
+	void runnerModeFailed();
+	
+	RunnerState runnerState = RUNNER_OFF;
+	// the latest frame, and the one we're uploading or playing
+	vector<LaserdockSample> runnerFrame;
+	uint64_t frameUnchangedMicros = 0;
+	int runnerUploadPosition = 0;
+	// there's no command to tell the firmware how long the loop is, so
+	// a frame that's shorter than the last one gets padded out to the
+	// same length with blank points
+	int runnerUploadSize = 0;
+	// the most we've loaded into the runner memory. Not reset when we
+	// reconnect, the DAC might not have been switched off.
+	int runnerSamplesLoaded = 0;
+	bool runnerFailed = false; // until we reconnect
+	std::atomic<bool> runnerModeEnabled{false};
+	std::atomic<float> runnerModeDelayMillis{500};
+	std::atomic<int> runnerStateDisplay{RUNNER_OFF};
+	// the firmware doesn't tell us how big its runner memory is, so
+	// this is on the safe side
+	static const int maxRunnerSamples = 2048;
+	// that's how many fit in the 64 byte load command
+	static const int runnerSamplesPerLoad = 7;
+	// blank points on the end of the stream before the runner starts,
+	// so the beam's dark while it waits for the buffer to run out
+	static const int runnerBlankSamples = 16;
+	
+	std::atomic<float> targetLatencyMillis{20};
+	// for getDisplayData, written by the DAC thread
+	std::atomic<int> deviceFillDisplay{0};
+	std::atomic<int> deviceCapacityDisplay{1799};
+	std::atomic<int> fillTargetDisplay{0};
+	std::atomic<int> underflowCount{0};
+	
+	LaserdockRegistry &registry;
 	LaserdockDevice * device = nullptr;
+	// we only try to reconnect when a Laserdock's been plugged in, or
+	// every so often in case it was there all along
+	uint32_t lastArrivalCount = 0;
+	uint64_t lastConnectAttemptMillis = 0;
+	const int reconnectIntervalMillis = 5000;
 	
-	LaserdockSample sendpoint, lastpoint;
-	deque<LaserdockSample*> bufferedPoints;
-	vector<LaserdockSample*> sparePoints;
-	vector<LaserdockSample> framePoints;
+	LaserdockSample lastpoint;
+	// the device's flip settings, the library flips x by default
+	std::atomic<bool> flipX{true};
+	std::atomic<bool> flipY{false};
+	// only the app thread adds points when we're not in frame mode,
+	// and only the DAC thread when we are
+	RingBuffer<LaserdockSample> bufferedPoints;
+	// frames from sendFrame, see TripleBuffer.h
+	TripleBuffer<vector<LaserdockSample>> frameBuffers;
 	
-	uint32_t pps, newPPS;
+	uint32_t pps = 30000;
+	uint32_t newPPS = 30000;
 	
-	bool frameMode = true; 
+	std::atomic<bool> frameMode{true};
 	bool replayFrames = true;
-	bool isReplaying = false;
 	bool connected = false;
 	
 	
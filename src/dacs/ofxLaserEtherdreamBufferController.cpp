@@ -0,0 +1,91 @@
+//
+//  ofxLaserEtherdreamBufferController.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserEtherdreamBufferController.h"
+
+using namespace ofxLaser;
+
+void EtherdreamBufferController :: setTargetLatency(float millis) {
+	targetLatencyMillis = MAX(millis, 0);
+}
+
+float EtherdreamBufferController :: getTargetLatency() const {
+	return targetLatencyMillis;
+}
+
+void EtherdreamBufferController :: setJitterMargin(float millis) {
+	jitterMarginMillis = MAX(millis, 0);
+}
+
+float EtherdreamBufferController :: getJitterMargin() const {
+	return jitterMarginMillis;
+}
+
+void EtherdreamBufferController :: addRoundTrip(uint64_t micros) {
+	
+	float roundtrip = micros;
+	// anything over a second is a reconnection or something,
+	// not a real measurement of the network
+	if(roundtrip>1000000) return;
+	
+	if(!hasRoundTrip) {
+		smoothedRoundTrip = roundtrip;
+		roundTripDeviation = roundtrip/2;
+		hasRoundTrip = true;
+	} else {
+		roundTripDeviation += (fabs(roundtrip - smoothedRoundTrip) - roundTripDeviation) * 0.25f;
+		smoothedRoundTrip += (roundtrip - smoothedRoundTrip) * 0.125f;
+	}
+}
+
+void EtherdreamBufferController :: updateCapacity(int bufferfullness) {
+	
+	maxFullnessSeen = MAX(maxFullnessSeen, bufferfullness);
+	if(bufferfullness>capacity) {
+		capacity = bufferfullness;
+	}
+}
+
+void EtherdreamBufferController :: bufferFull(int bufferfullness, int rejectedpoints) {
+	
+	maxFullnessSeen = MAX(maxFullnessSeen, bufferfullness);
+	
+	// it couldn't fit the rejected points on top of what it had, so
+	// that's more than it can hold. And it can hold at least as many
+	// as we've seen in it.
+	int limit = MIN(capacity, bufferfullness+rejectedpoints-1);
+	capacity = MAX(MAX(limit, maxFullnessSeen), minFillTarget);
+	if(!capacityConfirmed) {
+		ofLogNotice("EtherdreamBufferController : DAC buffer capacity is "+ofToString(capacity)+" points");
+	}
+	capacityConfirmed = true;
+}
+
+void EtherdreamBufferController :: update(uint32_t pps) {
+	
+	if(pps==0) return;
+	
+	// the buffer has to last from when we send the points until we hear back
+	// and can send some more. Four deviations covers nearly all of the spikes.
+	float safemillis = jitterMarginMillis;
+	if(hasRoundTrip) safemillis += (smoothedRoundTrip + roundTripDeviation*4)/1000.0f;
+	
+	// twice the safe time so that there's still room to send the
+	// points in decent sized batches
+	float latencymillis = MAX((float)targetLatencyMillis, safemillis*2);
+	
+	int maxpoints = capacityConfirmed ? capacity : capacity + capacityProbeStep;
+	
+	fillTarget = ofClamp(pps*latencymillis/1000.0f, minFillTarget, maxpoints);
+	
+	// keep the buffer between fillTarget-lowWaterMark and fillTarget, but
+	// the bottom of that range still has to cover the round trip
+	int safepoints = pps*safemillis/1000.0f;
+	lowWaterMark = MIN(fillTarget/2, fillTarget-safepoints);
+	lowWaterMark = MAX(lowWaterMark, 1);
+	minimumLevel = MIN(safepoints, fillTarget);
+}
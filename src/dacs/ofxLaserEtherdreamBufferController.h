@@ -0,0 +1,83 @@
+//
+//  ofxLaserEtherdreamBufferController.h
+//  ofxLaser
+//
+//
+//
+//  Works out how many points to keep in the Etherdream's buffer. We want
+//  as few as possible for low latency, but enough that the DAC never runs
+//  out while we're waiting to hear back from it. So we measure how long
+//  it takes the DAC to respond, and how much that varies, and make sure
+//  there's always at least that much time in the buffer (plus a margin).
+//  If the network is good then the buffer can shrink to the target latency.
+//
+//  It also works out how big the DAC's buffer really is. Etherdream 1 is
+//  1799 points but newer ones are bigger, so we start with 1799 and only
+//  go higher if the DAC tells us it's holding more than that.
+
+#pragma once
+
+#include "ofMain.h"
+#include <atomic>
+
+namespace ofxLaser {
+
+	class EtherdreamBufferController {
+
+		public :
+
+		// these two can be called from any thread
+		void setTargetLatency(float millis);
+		float getTargetLatency() const;
+		// extra time on top of the measured response time and variation
+		void setJitterMargin(float millis);
+		float getJitterMargin() const;
+
+		// everything else is for the DAC thread only
+
+		// time between sending a command and getting the response
+		void addRoundTrip(uint64_t micros);
+		// call with every response
+		void updateCapacity(int bufferfullness);
+		// call instead of updateCapacity if the DAC refused the points
+		// because its buffer was full
+		void bufferFull(int bufferfullness, int rejectedpoints);
+		// works out the new fill target and low water mark
+		void update(uint32_t pps);
+
+		// how many points we want in the DAC buffer
+		int getFillTarget() const { return fillTarget; };
+		// we don't top the DAC up until there's at least this much space,
+		// and don't start playing until there are this many points in it
+		int getLowWaterMark() const { return lowWaterMark; };
+		// if there are fewer points than this in the buffer then we might
+		// not get more to it in time, so it has to have something
+		int getMinimumLevel() const { return minimumLevel; };
+		int getCapacity() const { return capacity; };
+		float getRoundTripMillis() const { return smoothedRoundTrip/1000.0f; };
+		float getRoundTripDeviationMillis() const { return roundTripDeviation/1000.0f; };
+
+		protected :
+
+		std::atomic<float> targetLatencyMillis{15};
+		std::atomic<float> jitterMarginMillis{2};
+
+		// smoothed like TCP does it, see RFC 6298
+		float smoothedRoundTrip = 0;
+		float roundTripDeviation = 0;
+		bool hasRoundTrip = false;
+
+		int capacity = 1799;
+		bool capacityConfirmed = false; // true once the DAC has said it's full
+		int maxFullnessSeen = 0;
+		// how far past the known capacity we'll go to find out if there's more
+		const int capacityProbeStep = 200;
+
+		int fillTarget = 1200;
+		int lowWaterMark = 500;
+		int minimumLevel = 500;
+		// never go smaller than this, whatever the latency
+		const int minFillTarget = 100;
+
+	};
+}
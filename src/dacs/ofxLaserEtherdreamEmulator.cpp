@@ -0,0 +1,434 @@
+//
+//  ofxLaserEtherdreamEmulator.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserEtherdreamEmulator.h"
+
+using namespace ofxLaser;
+
+EtherdreamEmulator :: ~EtherdreamEmulator() {
+	close();
+}
+
+bool EtherdreamEmulator :: setup(int port, int buffersize) {
+
+	close();
+
+	this->port = port;
+	capacity = buffersize;
+
+	try {
+		Poco::Net::SocketAddress address("0.0.0.0", port);
+		server.bind(address, true);
+		server.listen(1);
+	} catch (Poco::Exception& exc) {
+		ofLog(OF_LOG_ERROR, "EtherdreamEmulator - couldn't listen on port "+ofToString(port)+" "+exc.displayText());
+		return false;
+	}
+
+	ofLog(OF_LOG_NOTICE, "EtherdreamEmulator listening on port "+ofToString(port));
+	startThread();
+	return true;
+}
+
+void EtherdreamEmulator :: close() {
+
+	if(isThreadRunning()) waitForThread();
+	disconnectClient();
+	try {
+		server.close();
+	} catch(...) {
+		// doesn't matter
+	}
+}
+
+EtherdreamEmulatorStats EtherdreamEmulator :: getStats() {
+	EtherdreamEmulatorStats copy;
+	while(!lock()) {}
+	copy = publishedStats;
+	unlock();
+	return copy;
+}
+
+void EtherdreamEmulator :: resetStats() {
+	resetStatsRequested = true;
+}
+
+void EtherdreamEmulator :: threadedFunction() {
+
+	while(isThreadRunning()) {
+
+		if(resetStatsRequested) {
+			int connections = stats.connections;
+			stats = EtherdreamEmulatorStats();
+			stats.connections = connections;
+			resetStatsRequested = false;
+		}
+
+		if(!clientConnected) {
+			acceptClient();
+		} else {
+
+			playPoints();
+
+			// when it's stalled we don't read anything or send anything,
+			// but it carries on playing
+			if(ofGetElapsedTimeMicros()>=stallUntilMicros) {
+				if(!readCommands()) {
+					disconnectClient();
+				} else {
+					processDueCommands();
+					if(!sendDueResponses()) disconnectClient();
+				}
+			}
+
+			// wait a little bit for more data, rather than spinning
+			if(clientConnected && pendingResponses.empty() && pendingCommands.empty()) {
+				try {
+					client.poll(Poco::Timespan(500), Poco::Net::Socket::SELECT_READ);
+				} catch(...) {
+					disconnectClient();
+				}
+			} else {
+				yield();
+			}
+		}
+
+		stats.bufferFullness = pointsQueued-pointsPlayed;
+		stats.pointRate = pointRate;
+		stats.playbackState = playbackState;
+		while(!lock()) {}
+		publishedStats = stats;
+		unlock();
+	}
+}
+
+void EtherdreamEmulator :: acceptClient() {
+
+	try {
+		if(!server.poll(Poco::Timespan(10000), Poco::Net::Socket::SELECT_READ)) return;
+		client = server.acceptConnection();
+		client.setNoDelay(true);
+		client.setBlocking(true);
+		client.setSendTimeout(Poco::Timespan(250000));
+	} catch (Poco::Exception& exc) {
+		ofLog(OF_LOG_ERROR, "EtherdreamEmulator - accept failed "+exc.displayText());
+		return;
+	}
+
+	clientConnected = true;
+	stats.connections++;
+
+	// a new connection always starts from scratch
+	lightEngineState = LIGHT_ENGINE_READY;
+	lightEngineFlags = 0;
+	playbackState = PLAYBACK_IDLE;
+	playbackFlags = 0;
+	pointRate = 0;
+	pointsQueued = pointsPlayed = 0;
+	pointsOwed = 0;
+	queuedRates.clear();
+	rateChangePoints.clear();
+	pendingResponses.clear();
+	pendingCommands.clear();
+	inputBufferSize = 0;
+	stallUntilMicros = 0;
+
+	// the etherdream sends its status as soon as you connect
+	queueResponse('a', '?');
+}
+
+void EtherdreamEmulator :: disconnectClient() {
+	if(!clientConnected) return;
+	try {
+		client.close();
+	} catch(...) {
+		// doesn't matter
+	}
+	clientConnected = false;
+	playbackState = PLAYBACK_IDLE;
+}
+
+bool EtherdreamEmulator :: readCommands() {
+
+	int available = 0;
+	try {
+		available = client.available();
+	} catch(...) {
+		return false;
+	}
+
+	// no data might just mean the other end has closed
+	if(available<=0) {
+		if(client.poll(Poco::Timespan(0), Poco::Net::Socket::SELECT_READ)) {
+			available = 1;
+		} else {
+			return true;
+		}
+	}
+
+	if(inputBuffer.size()<inputBufferSize+available) inputBuffer.resize(inputBufferSize+available);
+
+	int n = 0;
+	try {
+		n = client.receiveBytes(inputBuffer.data()+inputBufferSize, available);
+	} catch(...) {
+		return false;
+	}
+	if(n<=0) return false;
+	inputBufferSize+=n;
+
+	int pos = 0;
+	int length;
+	while((length = getCommandLength(&inputBuffer[pos], inputBufferSize-pos))>0) {
+		if(inputBufferSize-pos<length) break;
+
+		// half the latency is on the way here, the other half is on
+		// the way back
+		PendingCommand command;
+		command.dueMicros = ofGetElapsedTimeMicros() + getDelayMicros()/2;
+		if(!pendingCommands.empty()) command.dueMicros = MAX(command.dueMicros, pendingCommands.back().dueMicros);
+		command.data.assign(&inputBuffer[pos], &inputBuffer[pos]+length);
+		pendingCommands.push_back(std::move(command));
+		pos+=length;
+
+		// now and again the network stops for a bit
+		if((stallChance>0) && (ofRandom(1)<stallChance)) {
+			stallUntilMicros = ofGetElapsedTimeMicros() + stallMillis*1000;
+			break;
+		}
+	}
+
+	inputBufferSize-=pos;
+	if(inputBufferSize>0) memmove(inputBuffer.data(), &inputBuffer[pos], inputBufferSize);
+	return true;
+}
+
+int EtherdreamEmulator :: getCommandLength(const uint8_t* data, int available) {
+
+	if(available<1) return 0;
+	switch(data[0]) {
+		case 'b' :
+			return 7;
+		case 'q' :
+			return 5;
+		case 'd' :
+			if(available<3) return 0;
+			return 3 + DacBase::bytesToUInt16(&data[1])*sizeof(dac_point);
+		default :
+			return 1;
+	}
+}
+
+void EtherdreamEmulator :: processCommand(const uint8_t* data) {
+
+	uint8_t command = data[0];
+	uint8_t result = 'a';
+	stats.commandsReceived++;
+
+	switch(command) {
+
+		case '?' :
+			break;
+
+		case 'p' :
+			// prepare only works if we're stopped and the light engine is happy
+			if((lightEngineState==LIGHT_ENGINE_READY) && (playbackState==PLAYBACK_IDLE)) {
+				playbackState = PLAYBACK_PREPARED;
+				playbackFlags = 0;
+				pointsQueued = pointsPlayed = 0;
+				pointsOwed = 0;
+				queuedRates.clear();
+				rateChangePoints.clear();
+			} else {
+				result = 'I';
+			}
+			break;
+
+		case 'b' :
+			if(playbackState==PLAYBACK_PREPARED) {
+				pointRate = DacBase::bytesToUInt32(&data[3]);
+				playbackState = PLAYBACK_PLAYING;
+				lastPlayMicros = ofGetElapsedTimeMicros();
+				pointsOwed = 0;
+			} else {
+				result = 'I';
+			}
+			break;
+
+		case 'q' :
+			if(playbackState==PLAYBACK_IDLE) {
+				result = 'I';
+			} else {
+				queuedRates.push_back(DacBase::bytesToUInt32(&data[1]));
+			}
+			break;
+
+		case 'd' : {
+			int numpoints = DacBase::bytesToUInt16(&data[1]);
+			if(playbackState==PLAYBACK_IDLE) {
+				result = 'I';
+			} else if(pointsQueued-pointsPlayed+numpoints>capacity) {
+				// the real one throws the whole lot away
+				result = 'F';
+			} else {
+				// the only thing we care about in the points is the flag
+				// that says to change to the next point rate
+				const uint8_t* point = &data[3];
+				for(int i = 0; i<numpoints; i++) {
+					if(DacBase::bytesToUInt16(point) & 0b1000000000000000) {
+						rateChangePoints.push_back(pointsQueued+i);
+					}
+					point+=sizeof(dac_point);
+				}
+				pointsQueued+=numpoints;
+				stats.pointsReceived+=numpoints;
+				stats.maxBufferFullness = MAX(stats.maxBufferFullness, (int)(pointsQueued-pointsPlayed));
+			}
+			break;
+		}
+
+		case 's' :
+			if(playbackState==PLAYBACK_IDLE) {
+				result = 'I';
+			} else {
+				playbackState = PLAYBACK_IDLE;
+			}
+			break;
+
+		case 'c' :
+			if(lightEngineState==LIGHT_ENGINE_ESTOP) {
+				lightEngineState = LIGHT_ENGINE_READY;
+				lightEngineFlags = 0;
+			}
+			break;
+
+		case 0x00 :
+		case 0xff :
+			// emergency stop
+			lightEngineState = LIGHT_ENGINE_ESTOP;
+			lightEngineFlags |= 0b00001;
+			playbackState = PLAYBACK_IDLE;
+			break;
+
+		default :
+			// anything it doesn't recognise is also an emergency stop
+			lightEngineState = LIGHT_ENGINE_ESTOP;
+			lightEngineFlags |= 0b00001;
+			playbackState = PLAYBACK_IDLE;
+			result = 'I';
+			break;
+	}
+
+	if(result!='a') stats.naksSent++;
+	queueResponse(result, command);
+}
+
+void EtherdreamEmulator :: playPoints() {
+
+	uint64_t now = ofGetElapsedTimeMicros();
+	uint64_t elapsed = now-lastPlayMicros;
+	lastPlayMicros = now;
+
+	if(underflowRequested) {
+		pointsPlayed = pointsQueued;
+		underflowRequested = false;
+	}
+
+	if(playbackState!=PLAYBACK_PLAYING) return;
+
+	pointsOwed += (double)elapsed*pointRate/1000000.0;
+	uint64_t pointstoplay = (uint64_t)pointsOwed;
+	pointsOwed -= pointstoplay;
+
+	while(pointstoplay>0) {
+
+		// change the point rate if we've got to a point that says so
+		while(!rateChangePoints.empty() && (rateChangePoints.front()<=pointsPlayed)) {
+			rateChangePoints.pop_front();
+			if(!queuedRates.empty()) {
+				pointRate = queuedRates.front();
+				queuedRates.pop_front();
+			}
+		}
+
+		uint64_t available = pointsQueued-pointsPlayed;
+		if(available==0) {
+			// run out of points! The real one stops and you have
+			// to prepare it again
+			playbackState = PLAYBACK_IDLE;
+			playbackFlags |= 0b010;
+			stats.underflows++;
+			pointsOwed = 0;
+			break;
+		}
+
+		uint64_t count = MIN(pointstoplay, available);
+		if(!rateChangePoints.empty()) count = MIN(count, rateChangePoints.front()-pointsPlayed);
+		pointsPlayed+=count;
+		stats.pointsPlayed+=count;
+		pointstoplay-=count;
+	}
+}
+
+void EtherdreamEmulator :: queueResponse(uint8_t response, uint8_t command) {
+
+	PendingResponse pending;
+
+	// the status is taken now, even though it'll arrive later,
+	// just like it would be on a slow network
+	uint8_t* data = pending.data;
+	data[0] = response;
+	data[1] = command;
+	data[2] = 0; // protocol
+	data[3] = lightEngineState;
+	data[4] = playbackState;
+	data[5] = 0; // source
+	uint16_t fullness = MIN(pointsQueued-pointsPlayed, (uint64_t)0xffff);
+	uint32_t pointcount = pointsPlayed;
+	DacBase::writeUInt16ToBytes(lightEngineFlags, &data[6]);
+	DacBase::writeUInt16ToBytes(playbackFlags, &data[8]);
+	uint16_t sourceflags = 0;
+	DacBase::writeUInt16ToBytes(sourceflags, &data[10]);
+	DacBase::writeUInt16ToBytes(fullness, &data[12]);
+	DacBase::writeUInt32ToBytes(pointRate, &data[14]);
+	DacBase::writeUInt32ToBytes(pointcount, &data[18]);
+
+	pending.dueMicros = ofGetElapsedTimeMicros() + getDelayMicros()/2;
+	// responses never overtake each other
+	if(!pendingResponses.empty()) pending.dueMicros = MAX(pending.dueMicros, pendingResponses.back().dueMicros);
+	pendingResponses.push_back(pending);
+}
+
+uint64_t EtherdreamEmulator :: getDelayMicros() {
+	float delay = latencyMillis + ofRandom(jitterMillis);
+	return delay*1000;
+}
+
+void EtherdreamEmulator :: processDueCommands() {
+	uint64_t now = ofGetElapsedTimeMicros();
+	while(!pendingCommands.empty() && (pendingCommands.front().dueMicros<=now)) {
+		// catch up with the playing first so the status is right
+		playPoints();
+		processCommand(pendingCommands.front().data.data());
+		pendingCommands.pop_front();
+	}
+}
+
+bool EtherdreamEmulator :: sendDueResponses() {
+
+	uint64_t now = ofGetElapsedTimeMicros();
+	while(!pendingResponses.empty() && (pendingResponses.front().dueMicros<=now)) {
+		try {
+			int n = client.sendBytes(pendingResponses.front().data, 22);
+			if(n!=22) return false;
+		} catch(...) {
+			return false;
+		}
+		pendingResponses.pop_front();
+	}
+	return true;
+}
@@ -0,0 +1,136 @@
+//
+//  ofxLaserEtherdreamEmulator.h
+//  ofxLaser
+//
+//
+//
+//  Pretends to be an Etherdream so we can test DacEtherdream without one.
+//  It listens for a connection, answers the commands like the real thing,
+//  and plays points out of its buffer at the current point rate (it just
+//  counts them, they don't go anywhere). You can add network latency,
+//  jitter and stalls, and force it to run out of points, to see how
+//  DacEtherdream copes. The stats tell you how it got on.
+//
+//  Connect to it with dac.setup("127.0.0.1", emulator.getPort()).
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxLaserDacEtherdream.h"
+#include "Poco/Net/ServerSocket.h"
+#include <atomic>
+
+namespace ofxLaser {
+
+	struct EtherdreamEmulatorStats {
+		uint64_t pointsReceived = 0;
+		uint64_t pointsPlayed = 0;
+		int commandsReceived = 0;
+		int naksSent = 0;
+		int underflows = 0;
+		int connections = 0;
+		int maxBufferFullness = 0;
+		int bufferFullness = 0;
+		uint32_t pointRate = 0;
+		uint8_t playbackState = PLAYBACK_IDLE;
+	};
+
+	class EtherdreamEmulator : public ofThread {
+
+		public :
+
+		~EtherdreamEmulator();
+
+		// starts listening, returns false if it can't get the port
+		bool setup(int port = 7765, int buffersize = 1799);
+		void close();
+		int getPort() { return port; };
+
+		// these can all be changed while it's running, from any thread
+
+		// the round trip time, half of it is added to the commands on the
+		// way in and half to the responses on the way out
+		void setLatency(float millis) { latencyMillis = MAX(millis, 0); };
+		// random extra time (up to this much) added to the latency
+		void setJitter(float millis) { jitterMillis = MAX(millis, 0); };
+		// every command has this chance (0 to 1) of making it stop
+		// reading from the network for stallMillis. It keeps playing
+		// points while it's stalled, like the real thing would.
+		void setStalls(float chance, float millis) { stallChance = chance; stallMillis = MAX(millis, 0); };
+		// throws away everything in the buffer so it underflows
+		void forceUnderflow() { underflowRequested = true; };
+
+		EtherdreamEmulatorStats getStats();
+		void resetStats();
+
+		protected :
+
+		void threadedFunction();
+
+		void acceptClient();
+		void disconnectClient();
+		// reads what's available and handles any complete commands
+		bool readCommands();
+		// returns how many bytes the command at the start of the
+		// buffer needs, or 0 if we don't have enough to tell yet
+		int getCommandLength(const uint8_t* data, int available);
+		void processCommand(const uint8_t* data);
+		void processDueCommands();
+		void playPoints();
+		void queueResponse(uint8_t response, uint8_t command);
+		// the latency plus a random amount of jitter
+		uint64_t getDelayMicros();
+		bool sendDueResponses();
+
+		Poco::Net::ServerSocket server;
+		Poco::Net::StreamSocket client;
+		bool clientConnected = false;
+		int port = 7765;
+
+		std::atomic<float> latencyMillis{0};
+		std::atomic<float> jitterMillis{0};
+		std::atomic<float> stallChance{0};
+		std::atomic<float> stallMillis{0};
+		std::atomic<bool> underflowRequested{false};
+		std::atomic<bool> resetStatsRequested{false};
+		uint64_t stallUntilMicros = 0;
+
+		// everything below is only used by the emulator thread
+
+		int capacity = 1799;
+		uint8_t lightEngineState = LIGHT_ENGINE_READY;
+		uint8_t playbackState = PLAYBACK_IDLE;
+		uint16_t playbackFlags = 0;
+		uint16_t lightEngineFlags = 0;
+		uint32_t pointRate = 0;
+
+		// we don't keep the points, just count them. Fullness is
+		// pointsQueued - pointsPlayed.
+		uint64_t pointsQueued = 0;
+		uint64_t pointsPlayed = 0;
+		double pointsOwed = 0; // fractions of a point left over from last time
+		uint64_t lastPlayMicros = 0;
+		// point rate changes from 'q' commands, and the points they start at
+		deque<uint32_t> queuedRates;
+		deque<uint64_t> rateChangePoints;
+
+		struct PendingResponse {
+			uint64_t dueMicros;
+			uint8_t data[22];
+		};
+		deque<PendingResponse> pendingResponses;
+		struct PendingCommand {
+			uint64_t dueMicros;
+			vector<uint8_t> data;
+		};
+		deque<PendingCommand> pendingCommands;
+
+		vector<uint8_t> inputBuffer;
+		int inputBufferSize = 0;
+
+		EtherdreamEmulatorStats stats;
+		// a copy of stats for the other threads, only touched with the lock
+		EtherdreamEmulatorStats publishedStats;
+
+	};
+}
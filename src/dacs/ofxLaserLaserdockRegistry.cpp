@@ -0,0 +1,190 @@
+//
+//  ofxLaserLaserdockRegistry.cpp
+//  ofxLaser
+//
+//
+//
+
+#include "ofxLaserLaserdockRegistry.h"
+#include "LaserdockDeviceManager.h"
+#include <set>
+
+// same as in LaserdockDeviceManager.cpp
+#define LASERDOCK_VID 0x1fc9
+#define LASERDOCK_PID 0x04d8
+
+using namespace ofxLaser;
+
+LaserdockRegistry& LaserdockRegistry :: getInstance() {
+	static LaserdockRegistry instance;
+	return instance;
+}
+
+LaserdockRegistry :: LaserdockRegistry() {
+
+	// the device manager sets up libusb
+	LaserdockDeviceManager::getInstance();
+
+	if(libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG)) {
+		int result = libusb_hotplug_register_callback(NULL, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED, LIBUSB_HOTPLUG_NO_FLAGS, LASERDOCK_VID, LASERDOCK_PID, LIBUSB_HOTPLUG_MATCH_ANY, &LaserdockRegistry::hotplugCallback, this, &hotplugHandle);
+		hotplugAvailable = (result==0);
+		if(!hotplugAvailable) {
+			ofLogWarning("LaserdockRegistry - couldn't register for hotplug events : " + ofToString(libusb_error_name(result)));
+		}
+	}
+	if(!hotplugAvailable) {
+		ofLogNotice("LaserdockRegistry - no USB hotplug, looking for Laserdocks every " + ofToString(pollIntervalMillis) + "ms");
+	}
+
+	// get the devices that are already plugged in, these don't count
+	// as arrivals
+	pollDevices();
+}
+
+LaserdockRegistry :: ~LaserdockRegistry() {
+	if(hotplugAvailable) libusb_hotplug_deregister_callback(NULL, hotplugHandle);
+}
+
+int LIBUSB_CALL LaserdockRegistry :: hotplugCallback(libusb_context* context, libusb_device* device, libusb_hotplug_event event, void* userdata) {
+
+	// this happens inside libusb_handle_events on whichever thread
+	// called it, which might be in the middle of openDevice, so just
+	// count it and let the DAC threads do the rest
+	LaserdockRegistry& registry = *(LaserdockRegistry*)userdata;
+	registry.arrivalCount++;
+	return 0; // keep the callback
+}
+
+LaserdockDevice* LaserdockRegistry :: openDevice(string serial) {
+
+	std::lock_guard<std::mutex> lock(devicesMutex);
+
+	libusb_device** list;
+	int count = (int)libusb_get_device_list(NULL, &list);
+	if(count<0) {
+		ofLogError("LaserdockRegistry - couldn't get USB devices : " + ofToString(libusb_error_name(count)));
+		return nullptr;
+	}
+	updateDevices(list, count);
+
+	LaserdockDevice* opened = nullptr;
+	for(int i = 0; i<count; i++) {
+		libusb_device* usbdevice = list[i];
+		if(!isLaserdock(usbdevice)) continue;
+
+		KnownDevice& known = devices[getDeviceKey(usbdevice)];
+		// someone's already got it, or we know it's not the one we want
+		if(known.device!=nullptr) continue;
+		if((serial!="") && (known.serial!="") && (known.serial!=serial)) continue;
+
+		LaserdockDevice* device = new LaserdockDevice(usbdevice);
+		// it reads the serial number before it claims the interfaces,
+		// so we might get it even if it's in use by another program
+		if(device->serial_number()!="") known.serial = device->serial_number();
+
+		if((device->status()==LaserdockDevice::INITIALIZED) && ((serial=="") || (known.serial==serial))) {
+			known.device = device;
+			opened = device;
+			break;
+		}
+		delete device;
+	}
+	libusb_free_device_list(list, 1);
+
+	return opened;
+}
+
+void LaserdockRegistry :: closeDevice(LaserdockDevice* device) {
+
+	if(device==nullptr) return;
+	{
+		std::lock_guard<std::mutex> lock(devicesMutex);
+		for(auto& known : devices) {
+			if(known.second.device==device) known.second.device = nullptr;
+		}
+	}
+	delete device;
+}
+
+vector<string> LaserdockRegistry :: getSerialNumbers() {
+
+	pollDevices();
+	std::lock_guard<std::mutex> lock(devicesMutex);
+	vector<string> serials;
+	for(auto& known : devices) {
+		if(known.second.serial!="") serials.push_back(known.second.serial);
+	}
+	return serials;
+}
+
+bool LaserdockRegistry :: waitForArrival(uint32_t lastcount, int timeoutmillis) {
+
+	uint64_t endtime = ofGetElapsedTimeMicros() + (uint64_t)MAX(timeoutmillis, 0)*1000;
+	while(arrivalCount==lastcount) {
+		uint64_t now = ofGetElapsedTimeMicros();
+		if(now>=endtime) return false;
+		int waitmicros = (int)MIN(endtime-now, 100000);
+		if(hotplugAvailable) {
+			// the hotplug callback happens in here. Any other thread that's
+			// handling events might get it instead, that's fine.
+			struct timeval timeout = {0, waitmicros};
+			libusb_handle_events_timeout_completed(NULL, &timeout, NULL);
+		} else {
+			pollDevices();
+			ofSleepMillis(MAX(waitmicros/1000, 1));
+		}
+	}
+	return true;
+}
+
+void LaserdockRegistry :: pollDevices() {
+
+	std::lock_guard<std::mutex> lock(devicesMutex);
+
+	// every DacLaserdock that's waiting calls this, but we only need
+	// to look once for all of them
+	uint64_t now = ofGetElapsedTimeMicros();
+	if(devicesListed && (now-lastPollMicros < (uint64_t)pollIntervalMillis*1000)) return;
+	lastPollMicros = now;
+
+	libusb_device** list;
+	int count = (int)libusb_get_device_list(NULL, &list);
+	if(count<0) return;
+	updateDevices(list, count);
+	libusb_free_device_list(list, 1);
+}
+
+void LaserdockRegistry :: updateDevices(libusb_device** list, int count) {
+
+	set<int> present;
+	for(int i = 0; i<count; i++) {
+		if(!isLaserdock(list[i])) continue;
+		int key = getDeviceKey(list[i]);
+		present.insert(key);
+		if(devices.find(key)==devices.end()) {
+			devices[key] = KnownDevice();
+			// if we've got hotplug then it's already counted it
+			if(devicesListed && !hotplugAvailable) arrivalCount++;
+		}
+	}
+	// forget the ones that have gone, unless they're still open, in
+	// which case whoever's got it will close it when it stops working
+	for(auto it = devices.begin(); it!=devices.end();) {
+		if((present.find(it->first)==present.end()) && (it->second.device==nullptr)) {
+			it = devices.erase(it);
+		} else {
+			++it;
+		}
+	}
+	devicesListed = true;
+}
+
+bool LaserdockRegistry :: isLaserdock(libusb_device* device) {
+	struct libusb_device_descriptor descriptor;
+	if(libusb_get_device_descriptor(device, &descriptor)<0) return false;
+	return (descriptor.idVendor==LASERDOCK_VID) && (descriptor.idProduct==LASERDOCK_PID);
+}
+
+int LaserdockRegistry :: getDeviceKey(libusb_device* device) {
+	return (libusb_get_bus_number(device)<<8) | libusb_get_device_address(device);
+}
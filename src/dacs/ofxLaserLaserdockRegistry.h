@@ -0,0 +1,86 @@
+//
+//  ofxLaserLaserdockRegistry.h
+//  ofxLaser
+//
+//
+//
+//  Keeps track of which Laserdocks are plugged in, so that a DacLaserdock
+//  that's lost its DAC doesn't have to keep opening every USB device to
+//  look for it. libusb tells us when a Laserdock is plugged in (on the
+//  systems where it can, it can't on Windows), otherwise we look at the
+//  list of USB devices every so often, which is quick as long as we don't
+//  open them. Once we've opened a Laserdock we remember its serial number,
+//  so we don't open it again when we're looking for a different one.
+//
+//  There's only one of these, shared by all the DacLaserdocks.
+
+#pragma once
+
+#include "ofMain.h"
+#include "LaserdockDevice.h"
+#include "libusb.h"
+#include <atomic>
+
+namespace ofxLaser {
+
+	class LaserdockRegistry {
+
+		public :
+
+		static LaserdockRegistry& getInstance();
+
+		// all of these can be called from any thread
+
+		// opens the Laserdock with this serial number, or the first one
+		// that no-one else is using if serial is "". Returns nullptr if
+		// it isn't plugged in or can't be opened.
+		LaserdockDevice* openDevice(string serial);
+		// closes and deletes a device that came from openDevice
+		void closeDevice(LaserdockDevice* device);
+
+		// the serial numbers of the Laserdocks we've opened that are
+		// still plugged in
+		vector<string> getSerialNumbers();
+
+		// goes up every time a Laserdock is plugged in
+		uint32_t getArrivalCount() { return arrivalCount; };
+		// waits until the arrival count has changed from lastcount, or
+		// for timeoutmillis. Returns true if something was plugged in.
+		bool waitForArrival(uint32_t lastcount, int timeoutmillis);
+
+		bool isHotplugAvailable() { return hotplugAvailable; };
+
+		protected :
+
+		LaserdockRegistry();
+		~LaserdockRegistry();
+
+		static int LIBUSB_CALL hotplugCallback(libusb_context* context, libusb_device* device, libusb_hotplug_event event, void* userdata);
+
+		// looks at the list of USB devices (without opening any), at most
+		// once every pollIntervalMillis. Only needed without hotplug.
+		void pollDevices();
+		// forgets the devices that aren't in the list any more, and counts
+		// any new ones as arrivals. Call with devicesMutex locked.
+		void updateDevices(libusb_device** list, int count);
+		static bool isLaserdock(libusb_device* device);
+		// the bus number and address, which change if it's unplugged and
+		// plugged back in
+		static int getDeviceKey(libusb_device* device);
+
+		struct KnownDevice {
+			string serial; // empty until we've opened it
+			LaserdockDevice* device = nullptr; // if it's open
+		};
+		map<int, KnownDevice> devices;
+		std::mutex devicesMutex;
+		bool devicesListed = false;
+		uint64_t lastPollMicros = 0;
+		const int pollIntervalMillis = 500;
+
+		std::atomic<uint32_t> arrivalCount{0};
+		bool hotplugAvailable = false;
+		libusb_hotplug_callback_handle hotplugHandle;
+
+	};
+}
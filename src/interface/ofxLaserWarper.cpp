@@ -6,10 +6,35 @@
 //
 //
 
+// no fused multiply-adds in here, so that transformPoint matches
+// cv::perspectiveTransform exactly (see ofxLaserPointKernels.cpp)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#elif defined(_MSC_VER)
+#pragma fp_contract(off)
+#endif
+
 #include "ofxLaserWarper.h"
 
 using namespace ofxLaser; 
 
+inline void Warper :: transformPoint(const double* m, float& x, float& y) {
+	
+	// same as perspectiveTransform_ in OpenCV's matmul, w stays a double
+	// all the way through
+	double w = x*m[6] + y*m[7] + m[8];
+	if(fabs(w) > FLT_EPSILON) {
+		w = 1./w;
+		float px = (float)((x*m[0] + y*m[1] + m[2])*w);
+		float py = (float)((x*m[3] + y*m[4] + m[5])*w);
+		x = px;
+		y = py;
+	} else {
+		x = y = 0;
+	}
+}
 
 
 
@@ -37,6 +62,18 @@ void Warper::updateHomography(glm::vec3 src1, glm::vec3 src2, glm::vec3 src3, gl
 	} catch ( cv::Exception & e ) {
 		ofLog(OF_LOG_ERROR, e.msg ); // output exception message
 	}
+	
+	// keep a plain copy of the matrices so we don't have to go through
+	// OpenCV for every point
+	if(!homography.empty() && !inverseHomography.empty()) {
+		cv::Mat m;
+		homography.convertTo(m, CV_64F);
+		for(int i = 0; i<9; i++) homographyMatrix[i] = m.at<double>(i/3, i%3);
+		inverseHomography.convertTo(m, CV_64F);
+		for(int i = 0; i<9; i++) inverseHomographyMatrix[i] = m.at<double>(i/3, i%3);
+	} else {
+		ofLog(OF_LOG_ERROR, "Warper::updateHomography - couldn't find homography");
+	}
 }
 
 
@@ -63,20 +100,47 @@ ofxLaser::Point Warper::getWarpedPoint(const ofxLaser::Point& p, bool useHomogra
 }
 cv::Point2f Warper :: getWarpedPoint(float x, float y, bool useHomography) {
 
+	if(useHomography) {
+		transformPoint(homographyMatrix, x, y);
+		return cv::Point2f(x, y);
+	} else {
+		return getBilinearWarpedPoint(x, y);
+	}
+}
+
+void Warper :: warpPoints(const Point* src, Point* dst, int count, bool useHomography) {
+	
+	if(useHomography) {
+		for(int i = 0; i<count; i++) {
+			if(dst!=src) dst[i] = src[i];
+			transformPoint(homographyMatrix, dst[i].x, dst[i].y);
+		}
+	} else {
+		for(int i = 0; i<count; i++) {
+			cv::Point2f p = getBilinearWarpedPoint(src[i].x, src[i].y);
+			if(dst!=src) dst[i] = src[i];
+			dst[i].x = p.x;
+			dst[i].y = p.y;
+		}
+	}
+}
 
+void Warper :: warpPoints(float* xs, float* ys, int count, bool useHomography) {
+	
 	if(useHomography) {
-		if (post.size() < 1) post.resize(1);
-		if (pre.size() < 1) pre.resize(1);
-		pre[0].x = x;
-		pre[0].y = y;
-		try {
-			cv::perspectiveTransform(pre, post, homography);
-		} catch ( cv::Exception & e ) {
-			ofLog(OF_LOG_ERROR, e.msg ); // output exception message
+		for(int i = 0; i<count; i++) {
+			transformPoint(homographyMatrix, xs[i], ys[i]);
 		}
-		return post[0];
 	} else {
+		for(int i = 0; i<count; i++) {
+			cv::Point2f p = getBilinearWarpedPoint(xs[i], ys[i]);
+			xs[i] = p.x;
+			ys[i] = p.y;
+		}
+	}
+}
 
+cv::Point2f Warper :: getBilinearWarpedPoint(float x, float y) {
 
 //		P is the linear interpolation of A and B in u: P = A + (B-A)·u
 //		Q is the linear interpolation of D and C in u: Q = D + (C-D)·u
@@ -87,53 +151,29 @@ cv::Point2f Warper :: getWarpedPoint(float x, float y, bool useHomography) {
 //		X(u,v) = A + (B-A)·u + (D-A)·v + (A-B+C-D)·u·v
 
 
-		cv::Point2f d = srcCVPoints[3] - srcCVPoints[0];
-		float u = (x-(srcCVPoints[0].x))/d.x;
-		float v = (y-(srcCVPoints[0].y))/d.y;
-		cv::Point2f& A = dstCVPoints[0];
-		cv::Point2f& B = dstCVPoints[1];
-		cv::Point2f& C = dstCVPoints[3];
-		cv::Point2f& D = dstCVPoints[2];
+	cv::Point2f d = srcCVPoints[3] - srcCVPoints[0];
+	float u = (x-(srcCVPoints[0].x))/d.x;
+	float v = (y-(srcCVPoints[0].y))/d.y;
+	cv::Point2f& A = dstCVPoints[0];
+	cv::Point2f& B = dstCVPoints[1];
+	cv::Point2f& C = dstCVPoints[3];
+	cv::Point2f& D = dstCVPoints[2];
 
-		return A + (B-A)*u + (D-A)*v + (A-B+C-D)*u*v;
-
-	}
+	return A + (B-A)*u + (D-A)*v + (A-B+C-D)*u*v;
 }
 
 
 glm::vec3 Warper::getUnWarpedPoint(const glm::vec3& p, bool useHomography){
 
-
-
-	if (post.size() < 1) pre.resize(1);
-	if (post.size() < 1) pre.resize(1);
-	pre[0].x = p.x;
-	pre[0].y = p.y;
-
-	cv::perspectiveTransform(pre, post, inverseHomography);
-	ofPoint point = p;
-	point.x = post[0].x;
-	point.y = post[0].y;
-
+	glm::vec3 point = p;
+	transformPoint(inverseHomographyMatrix, point.x, point.y);
 	return point;
-
-	
 }
 
 
 ofxLaser::Point Warper::getUnWarpedPoint(const ofxLaser::Point& p, bool useHomography){
-	if(post.size()<1) pre.resize(1);
-	if(post.size()<1) pre.resize(1);
-	pre[0].x = p.x;
-	pre[0].y = p.y;
-	
-	cv::perspectiveTransform(pre, post, inverseHomography);
-	ofxLaser::Point point =p;
-	point.x = post[0].x;
-	point.y = post[0].y;
-	
+
+	ofxLaser::Point point = p;
+	transformPoint(inverseHomographyMatrix, point.x, point.y);
 	return point;
-	
-	
-	
 }
@@ -29,6 +29,12 @@ class Warper {
 	Point getWarpedPoint(const Point& p, bool useHomography = true);
 	cv::Point2f getWarpedPoint(float x, float y, bool useHomography = true);
 
+	// warps count points from src into dst, which can be the same array.
+	// Only the positions are changed, everything else is copied.
+	void warpPoints(const Point* src, Point* dst, int count, bool useHomography = true);
+	// same but for separate arrays of x and y positions, warped in place
+	void warpPoints(float* xs, float* ys, int count, bool useHomography = true);
+
 	Point getUnWarpedPoint(const Point& p, bool useHomography = true);
 	glm::vec3 getUnWarpedPoint(const glm::vec3& p, bool useHomography = true);
 	
@@ -45,7 +51,17 @@ class Warper {
 	
 	protected:
 	
-	vector<cv::Point2f> pre, post;
+	// applies a 3x3 matrix in exactly the same way as cv::perspectiveTransform
+	// does for float points, but without the overhead of calling it for
+	// every point
+	inline void transformPoint(const double* m, float& x, float& y);
+	cv::Point2f getBilinearWarpedPoint(float x, float y);
+	
+	// copies of homography and inverseHomography, doubles because that's
+	// what OpenCV uses
+	double homographyMatrix[9] = {1,0,0, 0,1,0, 0,0,1};
+	double inverseHomographyMatrix[9] = {1,0,0, 0,1,0, 0,0,1};
+	
 	vector<cv::Point2f> srcCVPoints, dstCVPoints;
 
 private:
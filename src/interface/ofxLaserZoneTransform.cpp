@@ -194,6 +194,72 @@ ofxLaser::Point ZoneTransform::getWarpedPoint(const ofxLaser::Point& p){
 	return quad.getWarpedPoint(p, useHomography);
 	
 };
+
+void ZoneTransform::warpPoints(Point* points, int count) {
+	
+	int numquads = quadWarpers.size();
+	if(numquads==1) {
+		quadWarpers[0].warpPoints(points, points, count, useHomography);
+		return;
+	}
+	
+	// figure out which quad each point is in and count them
+	pointQuads.resize(count);
+	quadCounts.assign(numquads+1, 0);
+	
+	float left = srcRect.getLeft();
+	float top = srcRect.getTop();
+	
+	for(int i = 0; i<count; i++) {
+		// same as getWarpedPoint
+		int x = ((points[i].x - left) / srcRect.getWidth()) * (float)(xDivisions);
+		int y = ((points[i].y - top) / srcRect.getHeight()) * (float)(yDivisions);
+		x = ofClamp(x,0,xDivisions-1);
+		y = ofClamp(y,0,yDivisions-1);
+		int quadnum = x + (y*xDivisions);
+		pointQuads[i] = quadnum;
+		quadCounts[quadnum+1]++;
+	}
+	
+	// if they're all in one quad, we don't need to sort them
+	int firstquad = (count>0) ? pointQuads[0] : 0;
+	if(quadCounts[firstquad+1]==count) {
+		quadWarpers[firstquad].warpPoints(points, points, count, useHomography);
+		return;
+	}
+	
+	// turn the counts into the start position of each bucket
+	for(int i = 0; i<numquads; i++) quadCounts[i+1]+=quadCounts[i];
+	
+	// copy the positions into buckets for each quad
+	bucketedIndices.resize(count);
+	bucketedX.resize(count);
+	bucketedY.resize(count);
+	for(int i = 0; i<count; i++) {
+		int bucketindex = quadCounts[pointQuads[i]]++;
+		bucketedIndices[bucketindex] = i;
+		bucketedX[bucketindex] = points[i].x;
+		bucketedY[bucketindex] = points[i].y;
+	}
+	
+	// each quad's count is now the end of its bucket
+	int start = 0;
+	for(int i = 0; i<numquads; i++) {
+		int end = quadCounts[i];
+		if(end>start) {
+			quadWarpers[i].warpPoints(&bucketedX[start], &bucketedY[start], end-start, useHomography);
+		}
+		start = end;
+	}
+	
+	// and put them back
+	for(int i = 0; i<count; i++) {
+		Point& p = points[bucketedIndices[i]];
+		p.x = bucketedX[i];
+		p.y = bucketedY[i];
+	}
+}
+
 //
 //Point getUnWarpedPoint(const Point& p){
 //	return p;
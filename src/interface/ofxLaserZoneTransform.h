@@ -80,6 +80,8 @@ class ZoneTransform {
 	
 	Point getWarpedPoint(const Point& p);
 	Point getUnWarpedPoint(const Point& p);
+	// warps all the points in place
+	void warpPoints(Point* points, int count);
 	ofPoint getWarpedPoint(const ofPoint& p);
 	ofPoint getUnWarpedPoint(const ofPoint& p);
 	
@@ -119,6 +121,13 @@ class ZoneTransform {
 	int xDivisions;
 	int yDivisions;
 	
+	// scratch buffers for warpPoints, kept so we don't allocate every frame
+	vector<int> pointQuads;
+	vector<int> quadCounts;
+	vector<int> bucketedIndices;
+	vector<float> bucketedX;
+	vector<float> bucketedY;
+	
 	//TODO move to utils
 	void drawDashedLine(ofPoint p1, ofPoint p2) {
 		
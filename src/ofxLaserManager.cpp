@@ -39,6 +39,10 @@ Manager::Manager() {
     useBitmapMask = false;
     showBitmapMask = false;
     laserMasks = false;
+	renderInParallel = false;
+	pinRenderThreads = false;
+	pullMode = false;
+	pullLeadMillis = 4;
 	currentProjector = -1;
     guiIsVisible = true;
 	
@@ -192,6 +196,13 @@ void Manager::update(){
 		updateZoneRects = updateZoneRects | zones[i]->update(); // is this dangerous? Optimisation may stop the function being called. 
 	}
     
+    // in pull mode figure out which projectors need a frame before
+    // the next time round, the others keep their last frame
+	float appFrameMillis = ofGetLastFrameTime()*1000;
+	for(int i = 0; i<projectors.size(); i++) {
+		projectors[i]->frameDue = pullMode ? projectors[i]->isFrameDue(pullLeadMillis, appFrameMillis) : true;
+	}
+	
     // update all the projectors which clears the points,
     // and updates all the zone settings
 	for(int i = 0; i<projectors.size(); i++) {
@@ -200,6 +211,13 @@ void Manager::update(){
 	zonesChanged = updateZoneRects;
 }
 
+bool Manager::isFrameNeeded() {
+	for(int i = 0; i<projectors.size(); i++) {
+		if(projectors[i]->frameDue) return true;
+	}
+	return false;
+}
+
 void Manager::send(){
 	
 	if(laserMasks) {
@@ -272,11 +290,29 @@ void Manager::send(){
 	// So - the shapes need to be sorted in projector space but their points need to be
 	// calculated at zone space. Otherwise the perspective distortion won't look right in
 	// terms of brightness distribution.
+	// (the ones that aren't getting a frame don't need anything made)
 	for(int i = 0; i<projectors.size(); i++) {
-		
-		Projector& p = *projectors[i];
-		
-		p.send(useBitmapMask?laserMask.getPixels():NULL, masterIntensity);
+		if(projectors[i]->frameDue) projectors[i]->prepareSend();
+	}
+	
+	ofPixels* pixels = useBitmapMask?laserMask.getPixels():NULL;
+	float intensity = masterIntensity;
+	
+	if(renderInParallel) {
+		// each projector renders on its own thread. The shapes are only
+		// read from here on, and run doesn't return until every projector
+		// has finished, so it's safe for update() to delete them afterwards.
+		renderThreads.setPinToCores(pinRenderThreads);
+		renderThreads.run(projectors.size(), [&](int i) {
+			projectors[i]->send(pixels, intensity);
+		});
+	} else {
+		for(int i = 0; i<projectors.size(); i++) {
+			
+			Projector& p = *projectors[i];
+			
+			p.send(pixels, intensity);
+		}
 	}
 }
 
@@ -620,6 +656,13 @@ void Manager::initGui(bool showExperimental) {
 	params.add(laserMasks.set("Laser mask shapes", laserMasks));
     
 	gui.add(params);
+	
+	threadParams.setName("Threads");
+	threadParams.add(renderInParallel.set("Render projectors in parallel", renderInParallel));
+	threadParams.add(pinRenderThreads.set("Pin render threads to cores", pinRenderThreads));
+	threadParams.add(pullMode.set("Render when DACs need frames", pullMode));
+	threadParams.add(pullLeadMillis.set("Render lead time (ms)", pullLeadMillis, 0, 20));
+	gui.add(threadParams);
     
 	if(customParams.size()>0) {
 		customParams.setName("Custom");
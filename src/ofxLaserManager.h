@@ -20,6 +20,7 @@
 #include "ofxLaserProjector.h"
 #include "ofxLaserDacBase.h"
 #include "ofxLaserMaskManager.h"
+#include "ofxLaserRenderThreadPool.h"
 #include "ofxGui.h"
 
 #define OFXLASER_PROFILE_FAST "FAST"
@@ -128,6 +129,26 @@ namespace ofxLaser {
         ofParameter<bool> showBitmapMask;
 		ofParameter<bool> laserMasks; 
 		
+		// renders all the projectors at the same time on separate threads.
+		// Only turn this on if any custom Shape classes are safe to use from
+		// more than one thread at once
+		ofParameter<bool> renderInParallel;
+		ofParameter<bool> pinRenderThreads;
+		
+		// instead of rendering every projector every app frame, only render
+		// a projector when its DAC is about to run out of points, so the
+		// frame is as fresh as possible when it goes out. pullLeadMillis is
+		// how long before the DAC needs it that we render it (enough for the
+		// render and getting it to the DAC thread). Only works with DACs that
+		// can tell when they'll need the next frame, the others still get
+		// one every app frame. Shapes only last until the next update(), so
+		// projectors that aren't due just don't use them.
+		ofParameter<bool> pullMode;
+		ofParameter<float> pullLeadMillis;
+		// true if any of the projectors want a frame this time, so apps
+		// can skip drawing when nobody needs it
+		bool isFrameNeeded();
+		
 		ofParameter<float>masterIntensity;
         
 		ofImage guideImage;
@@ -142,6 +163,7 @@ namespace ofxLaser {
 		
         ofxPanel gui;
         ofParameterGroup params;
+        ofParameterGroup threadParams;
         ofParameterGroup customParams;
         
         ofParameterGroup paramsLaser;
@@ -171,6 +193,8 @@ namespace ofxLaser {
 		std::vector<Projector*> projectors;
 		
 		std::deque <ofxLaser::Shape*> shapes;
+		
+		RenderThreadPool renderThreads;
         
 		ofPolyline tmpPoly; // to avoid generating polyline objects
 		int screenHeight;
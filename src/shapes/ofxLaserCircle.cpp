@@ -37,6 +37,10 @@ Circle::Circle(const ofPoint& center, const float radius, const ofColor& col, st
 	
 	endPos = vertices.back();
 	
+	// builds the polyline's length cache now rather than when
+	// the projector threads first ask for it
+	polyline.getPerimeter();
+	
 	tested = false;
 	profileLabel = profilelabel;
 	
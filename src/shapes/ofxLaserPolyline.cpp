@@ -14,7 +14,7 @@ Polyline::Polyline() {
 	
 	reversable = false;
 	colour = ofColor::white;
-	cachedProfile = NULL;
+	cache.clear();
 	multicoloured = false;
 	
 	tested = false;
@@ -37,7 +37,7 @@ void Polyline::init(const ofPolyline& poly, const ofColor& col, string profilela
 	
 	reversable = false;
 	colour = col;
-	cachedProfile = NULL;
+	cache.clear();
 	multicoloured = false;
 	
 	tested = false;
@@ -50,7 +50,7 @@ void Polyline::init(const ofPolyline& poly, const ofColor& col, string profilela
 void Polyline::init(const ofPolyline& poly, const vector<ofColor>& sourcecolours, string profilelabel){
 	
 	reversable = false;
-	cachedProfile = NULL;
+	cache.clear();
 	
 	multicoloured = true;
 	colours = sourcecolours; // should copy
@@ -95,7 +95,12 @@ void Polyline::initPoly(const ofPolyline& poly){
 	// to avoid a bug in polyline in open polys
 	endPos = vertices.back();
 	boundingBox = polyline.getBoundingBox();
-   
+	
+	// ofPolyline works out its lengths and angles the first time they're
+	// needed, so do it now while we're on the main thread. After that the
+	// polyline is only ever read.
+	polyline.getPerimeter();
+	
 	
 }
 
@@ -112,21 +117,26 @@ Polyline:: ~Polyline() {
 
 void Polyline::appendPointsToVector(vector<ofxLaser::Point>& points, const RenderProfile& profile, float speedMultiplier) {
 	
-	// TODO - take into account the speed multiplier!
 	ofPolyline& polyline = *polylinePointer;
-	if(&profile == cachedProfile) {
-//		ofLog(OF_LOG_NOTICE, "cached points used");
-		points.insert(points.end(), cachedPoints.begin(), cachedPoints.end());
-		return;
-	}
-
-	cachedProfile = &profile;
-	cachedPoints.clear();
 	
 	float acceleration = profile.acceleration;
 	float speed = profile.speed;
 	float cornerThresholdAngle = profile.cornerThreshold;
-
+	
+	// the same shape can be rendered by lots of projectors, often with
+	// the same settings, so we only work out the points once for each
+	// combination. The lock is only held to look up the entry, the
+	// points themselves are never changed once they're in the cache
+	// so it's fine to copy them out after we've let go of it.
+	std::shared_ptr<const vector<ofxLaser::Point>> cachedpoints = getCachedPoints(speed, acceleration, cornerThresholdAngle, speedMultiplier);
+	if(cachedpoints) {
+		points.insert(points.end(), cachedpoints->begin(), cachedpoints->end());
+		return;
+	}
+	
+	std::shared_ptr<vector<ofxLaser::Point>> newpointsptr = std::make_shared<vector<ofxLaser::Point>>();
+	vector<ofxLaser::Point>& newpoints = *newpointsptr;
+	
 	int startpoint = 0;
 	int endpoint = 0;
 	
@@ -147,7 +157,7 @@ void Polyline::appendPointsToVector(vector<ofxLaser::Point>& points, const Rende
 		
 		if(length>0) {
 			
-			vector<float>& unitDistances = getPointsAlongDistance(length, acceleration, speed, speedMultiplier);
+			vector<float> unitDistances = getPointsAlongDistance(length, acceleration, speed, speedMultiplier);
 			
 			
 			for(int i = 0; i<unitDistances.size(); i++) {
@@ -159,11 +169,11 @@ void Polyline::appendPointsToVector(vector<ofxLaser::Point>& points, const Rende
 				if(multicoloured) {
 					int colourindex = round(polyline.getIndexAtLength(distanceAlongPoly)); // TODO - interpolate?
 					colourindex = ofClamp(colourindex, 0,colours.size());
-					cachedPoints.push_back(ofxLaser::Point(p, colours[colourindex]));
+					newpoints.push_back(ofxLaser::Point(p, colours[colourindex]));
 					
 				} else {
 					
-					cachedPoints.push_back(ofxLaser::Point(p, colour));
+					newpoints.push_back(ofxLaser::Point(p, colour));
 				}
 				
 				lastpoint = p;
@@ -174,8 +184,36 @@ void Polyline::appendPointsToVector(vector<ofxLaser::Point>& points, const Rende
 		startpoint=endpoint;
 		
 	}
-	points.insert(points.end(), cachedPoints.begin(), cachedPoints.end());
+	points.insert(points.end(), newpoints.begin(), newpoints.end());
 	
+	addCachedPoints(speed, acceleration, cornerThresholdAngle, speedMultiplier, newpointsptr);
+	
+}
+
+std::shared_ptr<const vector<ofxLaser::Point>> Polyline :: getCachedPoints(float speed, float acceleration, float cornerThreshold, float speedMultiplier) {
+	
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	for(CacheEntry& entry : cache) {
+		if(entry.matches(speed, acceleration, cornerThreshold, speedMultiplier)) {
+			return entry.points;
+		}
+	}
+	return nullptr;
+}
+
+void Polyline :: addCachedPoints(float speed, float acceleration, float cornerThreshold, float speedMultiplier, std::shared_ptr<const vector<ofxLaser::Point>> points) {
+	
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	// another thread might have beaten us to it
+	for(CacheEntry& entry : cache) {
+		if(entry.matches(speed, acceleration, cornerThreshold, speedMultiplier)) {
+			return;
+		}
+	}
+	// throw away the oldest if it's full. Anything still using
+	// its points keeps them alive through the shared_ptr
+	if(cache.size()>=maxCacheEntries) cache.erase(cache.begin());
+	cache.push_back({speed, acceleration, cornerThreshold, speedMultiplier, points});
 }
 
 void Polyline :: addPreviewToMesh(ofMesh& mesh){
@@ -33,8 +33,26 @@ namespace ofxLaser {
 		protected :
 		void initPoly(const ofPolyline& poly);
 		ofPolyline* polylinePointer = NULL;
-		const RenderProfile* cachedProfile;
-		std::vector<ofxLaser::Point> cachedPoints;
+		
+		// the points for each combination of render settings
+		struct CacheEntry {
+			float speed;
+			float acceleration;
+			float cornerThreshold;
+			float speedMultiplier;
+			std::shared_ptr<const vector<ofxLaser::Point>> points;
+			
+			bool matches(float s, float a, float c, float m) const {
+				return (speed==s) && (acceleration==a) && (cornerThreshold==c) && (speedMultiplier==m);
+			}
+		};
+		std::shared_ptr<const vector<ofxLaser::Point>> getCachedPoints(float speed, float acceleration, float cornerThreshold, float speedMultiplier);
+		void addCachedPoints(float speed, float acceleration, float cornerThreshold, float speedMultiplier, std::shared_ptr<const vector<ofxLaser::Point>> points);
+		
+		static const int maxCacheEntries = 4;
+		vector<CacheEntry> cache;
+		std::mutex cacheMutex;
+		
 		std::vector<ofColor> colours;
 		bool multicoloured;
 		ofRectangle boundingBox; 
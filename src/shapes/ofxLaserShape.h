@@ -21,11 +21,13 @@ class Shape {
 	};
 	virtual void addPreviewToMesh(ofMesh& mesh) =0;
 	
-	vector<float>& getPointsAlongDistance(float distance, float acceleration, float speed, float speedMultiplier){
+	// returns a new vector rather than filling a member so that shapes can be
+	// rendered by more than one projector thread at once
+	vector<float> getPointsAlongDistance(float distance, float acceleration, float speed, float speedMultiplier) const {
 		
         speed*=speedMultiplier;
         acceleration*=speedMultiplier;
-		unitDistances.clear();
+		vector<float> unitDistances;
 		
 		float acceleratedistance = (speed*speed) / (2*acceleration);
 		float timetogettospeed = speed / acceleration;
@@ -81,8 +83,6 @@ class Shape {
 		
 	}
 
-	vector<float> unitDistances;
-	
 	bool tested = false;
 	bool reversed = false;
 	bool reversable = false; 
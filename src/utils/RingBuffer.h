@@ -0,0 +1,193 @@
+//
+//  RingBuffer.h
+//  ofxLaser
+//
+//
+//
+//  A fixed size queue for passing values from one thread to another
+//  without a lock. It's only safe with ONE thread adding (the producer)
+//  and ONE thread taking things out (the consumer). The values are
+//  stored in place, so there's no allocation once it's set up.
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <stddef.h>
+
+namespace ofxLaser {
+
+	template<typename T>
+	class RingBuffer {
+
+		public :
+
+		RingBuffer(size_t mincapacity = 1024) {
+			setCapacity(mincapacity);
+		}
+
+		// rounds up to the next power of two. Not thread safe, and
+		// anything in the buffer is lost.
+		void setCapacity(size_t mincapacity) {
+			size_t newcapacity = 1;
+			while(newcapacity<mincapacity) newcapacity<<=1;
+			items.assign(newcapacity, T());
+			mask = newcapacity-1;
+			head.store(0, std::memory_order_relaxed);
+			tail.store(0, std::memory_order_relaxed);
+			producerTail = 0;
+			consumerHead = 0;
+		}
+
+		size_t capacity() const {
+			return items.size();
+		}
+
+		// only exact from the producer or consumer thread, from
+		// anywhere else it's a good guess
+		size_t size() const {
+			size_t t = tail.load(std::memory_order_acquire);
+			size_t h = head.load(std::memory_order_acquire);
+			return h-t;
+		}
+
+		bool empty() const {
+			return size()==0;
+		}
+
+		// PRODUCER ONLY ------------------------------------------------
+
+		size_t getSpace() {
+			size_t h = head.load(std::memory_order_relaxed);
+			producerTail = tail.load(std::memory_order_acquire);
+			return items.size()-(h-producerTail);
+		}
+
+		bool push(const T& value) {
+			size_t h = head.load(std::memory_order_relaxed);
+			if(h-producerTail==items.size()) {
+				// we only look at the real tail when we think we're full,
+				// saves fighting the consumer for the cache line
+				producerTail = tail.load(std::memory_order_acquire);
+				if(h-producerTail==items.size()) return false;
+			}
+			items[h & mask] = value;
+			head.store(h+1, std::memory_order_release);
+			return true;
+		}
+
+		// adds as many as will fit and returns how many that was
+		size_t push(const T* values, size_t count) {
+			size_t h = head.load(std::memory_order_relaxed);
+			if(items.size()-(h-producerTail)<count) {
+				producerTail = tail.load(std::memory_order_acquire);
+			}
+			size_t space = items.size()-(h-producerTail);
+			if(count>space) count = space;
+			for(size_t i = 0; i<count; i++) {
+				items[(h+i) & mask] = values[i];
+			}
+			head.store(h+count, std::memory_order_release);
+			return count;
+		}
+
+		// CONSUMER ONLY ------------------------------------------------
+
+		// always looks at the real head, otherwise it can miss things
+		// that have been added since we last looked
+		size_t getAvailable() {
+			size_t t = tail.load(std::memory_order_relaxed);
+			consumerHead = head.load(std::memory_order_acquire);
+			return consumerHead-t;
+		}
+
+		bool pop(T& value) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			if(consumerHead==t) {
+				consumerHead = head.load(std::memory_order_acquire);
+				if(consumerHead==t) return false;
+			}
+			value = items[t & mask];
+			tail.store(t+1, std::memory_order_release);
+			return true;
+		}
+
+		// takes up to maxcount values out and returns how many it got
+		size_t pop(T* values, size_t maxcount) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			if(consumerHead-t<maxcount) {
+				consumerHead = head.load(std::memory_order_acquire);
+			}
+			size_t count = consumerHead-t;
+			if(count>maxcount) count = maxcount;
+			for(size_t i = 0; i<count; i++) {
+				values[i] = items[(t+i) & mask];
+			}
+			tail.store(t+count, std::memory_order_release);
+			return count;
+		}
+
+		// gets at the values in place, without copying them out. They
+		// might wrap round the end of the buffer so they come in two
+		// runs (second is empty if they don't). They stay in the buffer
+		// until you call discard(...).
+		size_t peek(size_t maxcount, T*& first, size_t& firstcount, T*& second, size_t& secondcount) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			if(consumerHead-t<maxcount) {
+				consumerHead = head.load(std::memory_order_acquire);
+			}
+			size_t count = consumerHead-t;
+			if(count>maxcount) count = maxcount;
+			size_t start = t & mask;
+			firstcount = std::min(count, items.size()-start);
+			secondcount = count-firstcount;
+			first = items.data()+start;
+			second = items.data();
+			return count;
+		}
+
+		// removes values that you've finished with after peek(...)
+		void discard(size_t count) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			tail.store(t+count, std::memory_order_release);
+		}
+
+		// lets the consumer change values that are still waiting to be
+		// taken out. The producer never touches them once they're in.
+		template<typename F>
+		void forEachQueued(F function) {
+			size_t t = tail.load(std::memory_order_relaxed);
+			consumerHead = head.load(std::memory_order_acquire);
+			for(size_t i = t; i!=consumerHead; i++) {
+				function(items[i & mask]);
+			}
+		}
+
+		void clear() {
+			size_t h = head.load(std::memory_order_acquire);
+			consumerHead = h;
+			tail.store(h, std::memory_order_release);
+		}
+
+		protected :
+
+		static const size_t cacheLineSize = 64;
+
+		std::vector<T> items;
+		size_t mask = 0;
+
+		// head and tail live on their own cache lines so the two threads
+		// aren't invalidating each other's cache every time they move.
+		// Each side also keeps its own copy of the other side's position
+		// so it only needs to read the shared one when it runs out.
+		char padding0[cacheLineSize];
+		std::atomic<size_t> head; // next slot to write, only the producer changes it
+		size_t producerTail = 0;
+		char padding1[cacheLineSize];
+		std::atomic<size_t> tail; // next slot to read, only the consumer changes it
+		size_t consumerHead = 0;
+		char padding2[cacheLineSize];
+
+	};
+}
@@ -0,0 +1,127 @@
+//
+//  SimdUtils.h
+//  ofxLaser
+//
+//
+//
+//  A tiny wrapper around 4 wide float vectors so that the point processing
+//  can be written once and use SSE2 on intel, NEON on ARM, or plain floats
+//  on anything else. Only the operations we actually need are here.
+//  There's no fused multiply-add, so the results are exactly the same as
+//  doing the maths one float at a time, as long as the compiler doesn't
+//  fuse them itself (see ofxLaserPointKernels.cpp).
+//
+//  Define OFXLASER_NO_SIMD to use the plain floats everywhere.
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(OFXLASER_NO_SIMD)
+// plain floats
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define OFXLASER_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define OFXLASER_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace ofxLaser {
+namespace simd {
+
+#if defined(OFXLASER_SIMD_SSE2)
+
+	typedef __m128 float4;
+	typedef __m128 mask4;
+
+	inline float4 load(const float* p) { return _mm_loadu_ps(p); }
+	inline void store(float* p, float4 v) { _mm_storeu_ps(p, v); }
+	inline float4 set(float f) { return _mm_set1_ps(f); }
+	inline float4 add(float4 a, float4 b) { return _mm_add_ps(a, b); }
+	inline float4 sub(float4 a, float4 b) { return _mm_sub_ps(a, b); }
+	inline float4 mul(float4 a, float4 b) { return _mm_mul_ps(a, b); }
+	inline float4 div(float4 a, float4 b) { return _mm_div_ps(a, b); }
+	inline mask4 lessThan(float4 a, float4 b) { return _mm_cmplt_ps(a, b); }
+	inline mask4 greaterThan(float4 a, float4 b) { return _mm_cmpgt_ps(a, b); }
+	inline mask4 greaterOrEqual(float4 a, float4 b) { return _mm_cmpge_ps(a, b); }
+	inline mask4 maskOr(mask4 a, mask4 b) { return _mm_or_ps(a, b); }
+	// where mask is set use a, otherwise b
+	inline float4 select(mask4 mask, float4 a, float4 b) {
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+	// mask is set for every lane where the flag has any of the bits in bit
+	inline mask4 flagsSet(const uint8_t* flags, uint8_t bit) {
+		__m128i f = _mm_set_epi32(flags[3]&bit, flags[2]&bit, flags[1]&bit, flags[0]&bit);
+		return _mm_castsi128_ps(_mm_cmpgt_epi32(f, _mm_setzero_si128()));
+	}
+
+#elif defined(OFXLASER_SIMD_NEON)
+
+	typedef float32x4_t float4;
+	typedef uint32x4_t mask4;
+
+	inline float4 load(const float* p) { return vld1q_f32(p); }
+	inline void store(float* p, float4 v) { vst1q_f32(p, v); }
+	inline float4 set(float f) { return vdupq_n_f32(f); }
+	inline float4 add(float4 a, float4 b) { return vaddq_f32(a, b); }
+	inline float4 sub(float4 a, float4 b) { return vsubq_f32(a, b); }
+	inline float4 mul(float4 a, float4 b) { return vmulq_f32(a, b); }
+	inline float4 div(float4 a, float4 b) {
+#if defined(__aarch64__)
+		return vdivq_f32(a, b);
+#else
+		// armv7 doesn't have a divide (and its reciprocal estimate isn't
+		// exact) so do it a lane at a time
+		float fa[4], fb[4];
+		vst1q_f32(fa, a);
+		vst1q_f32(fb, b);
+		for(int i = 0; i<4; i++) fa[i]/=fb[i];
+		return vld1q_f32(fa);
+#endif
+	}
+	inline mask4 lessThan(float4 a, float4 b) { return vcltq_f32(a, b); }
+	inline mask4 greaterThan(float4 a, float4 b) { return vcgtq_f32(a, b); }
+	inline mask4 greaterOrEqual(float4 a, float4 b) { return vcgeq_f32(a, b); }
+	inline mask4 maskOr(mask4 a, mask4 b) { return vorrq_u32(a, b); }
+	inline float4 select(mask4 mask, float4 a, float4 b) { return vbslq_f32(mask, a, b); }
+	inline mask4 flagsSet(const uint8_t* flags, uint8_t bit) {
+		uint32_t f[4] = {(uint32_t)(flags[0]&bit), (uint32_t)(flags[1]&bit), (uint32_t)(flags[2]&bit), (uint32_t)(flags[3]&bit)};
+		return vcgtq_u32(vld1q_u32(f), vdupq_n_u32(0));
+	}
+
+#else
+
+	// plain float fallback
+	struct float4 {
+		float v[4];
+	};
+	struct mask4 {
+		bool v[4];
+	};
+
+	inline float4 load(const float* p) { float4 r; for(int i = 0; i<4; i++) r.v[i] = p[i]; return r; }
+	inline void store(float* p, float4 a) { for(int i = 0; i<4; i++) p[i] = a.v[i]; }
+	inline float4 set(float f) { float4 r; for(int i = 0; i<4; i++) r.v[i] = f; return r; }
+	inline float4 add(float4 a, float4 b) { for(int i = 0; i<4; i++) a.v[i]+=b.v[i]; return a; }
+	inline float4 sub(float4 a, float4 b) { for(int i = 0; i<4; i++) a.v[i]-=b.v[i]; return a; }
+	inline float4 mul(float4 a, float4 b) { for(int i = 0; i<4; i++) a.v[i]*=b.v[i]; return a; }
+	inline float4 div(float4 a, float4 b) { for(int i = 0; i<4; i++) a.v[i]/=b.v[i]; return a; }
+	inline mask4 lessThan(float4 a, float4 b) { mask4 m; for(int i = 0; i<4; i++) m.v[i] = a.v[i]<b.v[i]; return m; }
+	inline mask4 greaterThan(float4 a, float4 b) { mask4 m; for(int i = 0; i<4; i++) m.v[i] = a.v[i]>b.v[i]; return m; }
+	inline mask4 greaterOrEqual(float4 a, float4 b) { mask4 m; for(int i = 0; i<4; i++) m.v[i] = a.v[i]>=b.v[i]; return m; }
+	inline mask4 maskOr(mask4 a, mask4 b) { for(int i = 0; i<4; i++) a.v[i] = a.v[i] || b.v[i]; return a; }
+	inline float4 select(mask4 mask, float4 a, float4 b) { for(int i = 0; i<4; i++) if(!mask.v[i]) a.v[i] = b.v[i]; return a; }
+	inline mask4 flagsSet(const uint8_t* flags, uint8_t bit) { mask4 m; for(int i = 0; i<4; i++) m.v[i] = (flags[i]&bit)!=0; return m; }
+
+#endif
+
+	// clamp that keeps the point unchanged if it's NaN, same as
+	// if(x<min) x = min; else if(x>max) x = max;
+	inline float4 clamp(float4 v, float4 minimum, float4 maximum) {
+		v = select(lessThan(v, minimum), minimum, v);
+		return select(greaterThan(v, maximum), maximum, v);
+	}
+
+}
+}
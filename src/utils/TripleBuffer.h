@@ -0,0 +1,77 @@
+//
+//  TripleBuffer.h
+//  ofxLaser
+//
+//
+//
+//  For handing whole frames from the app thread to a DAC thread without
+//  either of them ever waiting for the other. There are three copies of
+//  the frame: the app writes into one, the DAC reads from another, and
+//  the third is the most recent finished frame that's waiting to be
+//  picked up. Swapping them is just an atomic exchange of an index.
+//
+//  Only safe with one writing thread and one reading thread.
+
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+namespace ofxLaser {
+
+	template<typename T>
+	class TripleBuffer {
+
+		public :
+
+		// WRITER ONLY --------------------------------------------------
+
+		// the buffer to fill with the next frame, it keeps whatever was
+		// in it from a couple of frames ago, so you can reuse its memory
+		T& getWriteBuffer() {
+			return buffers[writeIndex];
+		}
+
+		// makes the write buffer the latest frame. If the reader hadn't
+		// got round to the previous one then it's just replaced.
+		void publish() {
+			uint8_t previous = waiting.exchange(writeIndex | newFrameFlag, std::memory_order_acq_rel);
+			writeIndex = previous & indexMask;
+		}
+
+		// READER ONLY --------------------------------------------------
+
+		// swaps in the latest frame if there is one, returns true if
+		// the read buffer changed
+		bool update() {
+			if(!(waiting.load(std::memory_order_relaxed) & newFrameFlag)) return false;
+			uint8_t previous = waiting.exchange(readIndex, std::memory_order_acq_rel);
+			readIndex = previous & indexMask;
+			return true;
+		}
+
+		// the latest frame we picked up with update()
+		T& getReadBuffer() {
+			return buffers[readIndex];
+		}
+
+		// ANY THREAD ---------------------------------------------------
+
+		bool hasNewFrame() const {
+			return (waiting.load(std::memory_order_relaxed) & newFrameFlag)!=0;
+		}
+
+		protected :
+
+		static const uint8_t indexMask = 0x03;
+		static const uint8_t newFrameFlag = 0x04;
+
+		T buffers[3];
+		uint8_t writeIndex = 0;
+		uint8_t readIndex = 1;
+		// index of the buffer in the middle plus newFrameFlag
+		// if it hasn't been read yet
+		std::atomic<uint8_t> waiting{2};
+
+	};
+}